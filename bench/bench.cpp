@@ -0,0 +1,411 @@
+/*
+	End to end benchmark for wordsquares, bench.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Times the preprocessing program on the sample wordlist,
+	then the wordsquare program on every seed set of a fixed corpus,
+	each run repeated, as separate processes the way they are used.
+	For every case it reports the median and 95th percentile wall time,
+	and the peak resident memory.  Solver cases also report the search
+	time the program prints, search nodes and solutions per second.
+
+	Results are printed as a table and written as JSON, one case per line,
+	and two JSON files, from two builds, can be compared with --compare.
+	See Section 8 of the README
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+/* one benchmark case and its measurements */
+struct Case {
+	string name;
+	int numseeds;				// 0 for preprocessing
+	vector<string> seeds;
+	vector<double> wall;		// wall time of each run in ms
+	vector<double> search;		// search time printed by the solver, in ms
+	long solutions;
+	long nodes;
+	long peak_rss;				// KB, largest over the runs
+	long items;					// wordlist lines, for preprocessing
+};
+
+/* run a program and collect what it printed, its wall time, and its memory */
+bool run_process(vector<string>&, string&, double&, long&);
+string find_value(string&, string);
+double percentile(vector<double>, double);
+
+/* benchmark cases */
+void bench_preproc(Case&, string, string, int);
+void bench_solver(Case&, string, vector<string>&, string, int);
+vector<Case> read_corpus(string);
+
+/* reports */
+void print_table(vector<Case>&);
+void write_json(vector<Case>&, string, int);
+int compare(string, string);
+void usage();
+
+int main(int argc, char* argv[]) {
+
+	int repeats = 5;
+	string jsonfile = "bench/results.json";
+	string wordlist = "wordlist/wordlist-20210729.txt";
+	string index = "input/index.sample";
+	string corpus = "bench/corpus.list";
+	vector<string> solver_opts;
+
+	for(int i=1; i<argc; i++) {
+		string arg = argv[i];
+		if( arg == "--compare" && i+2<argc ) {
+			return compare(argv[i+1], argv[i+2]);
+		} else if( arg == "-r" && i+1<argc ) {
+			repeats = atoi(argv[++i]);
+		} else if( arg == "-o" && i+1<argc ) {
+			jsonfile = argv[++i];
+		} else if( arg == "-w" && i+1<argc ) {
+			wordlist = argv[++i];
+		} else if( arg == "-i" && i+1<argc ) {
+			index = argv[++i];
+		} else if( arg == "-s" && i+1<argc ) {
+			corpus = argv[++i];
+		} else if( arg == "--" ) {
+			for(i++; i<argc; i++) solver_opts.push_back(argv[i]);
+		} else {
+			usage();
+			return -1;
+		}
+	}
+	if( repeats < 1 ) {
+		usage();
+		return -1;
+	}
+
+	char tmpdir[] = "/tmp/wsbench.XXXXXX";
+	if( mkdtemp(tmpdir) == NULL ) {
+		cout << "ERROR: cannot create a temporary directory" << endl;
+		return -1;
+	}
+
+	vector<Case> cases;
+	Case pre;
+	pre.name = "preproc";
+	pre.numseeds = 0;
+	cout << "benchmarking preprocessing of " << wordlist << ", " << repeats << " runs" << endl;
+	bench_preproc(pre, wordlist, tmpdir, repeats);
+	cases.push_back(pre);
+
+	vector<Case> solves = read_corpus(corpus);
+	for(unsigned i=0; i<solves.size(); i++) {
+		cout << "benchmarking " << solves[i].name << ", " << repeats << " runs" << endl;
+		bench_solver(solves[i], index, solver_opts, tmpdir, repeats);
+		cases.push_back(solves[i]);
+	}
+
+	string cleanup = string("rm -rf ") + tmpdir;
+	if( system(cleanup.c_str()) != 0 ) {
+		cout << "could not remove " << tmpdir << endl;
+	}
+
+	print_table(cases);
+	write_json(cases, jsonfile, repeats);
+	return 0;
+}
+
+/*
+	Run argv[0] with its arguments and wait for it.
+	Everything it prints to stdout and stderr goes to out.
+	Sets the wall time in ms and the peak resident memory in KB.
+	Return false if it couldn't run or didn't exit with 0
+*/
+bool run_process(vector<string>& args, string& out, double& ms, long& rss) {
+	int fds[2];
+	if( pipe(fds) < 0 ) return false;
+
+	auto start = chrono::steady_clock::now();
+	pid_t pid = fork();
+	if( pid < 0 ) return false;
+	if( pid == 0 ) {
+		dup2(fds[1], STDOUT_FILENO);
+		dup2(fds[1], STDERR_FILENO);
+		close(fds[0]);
+		close(fds[1]);
+		vector<char*> argv;
+		for(unsigned i=0; i<args.size(); i++) argv.push_back( (char*)args[i].c_str() );
+		argv.push_back(NULL);
+		execv(argv[0], argv.data());
+		_exit(127);
+	}
+
+	close(fds[1]);
+	out.clear();
+	char buf[4096];
+	ssize_t n;
+	while( (n = read(fds[0], buf, sizeof(buf))) > 0 ) out.append(buf, n);
+	close(fds[0]);
+
+	int status;
+	struct rusage usage;
+	wait4(pid, &status, 0, &usage);
+	ms = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() / 1000.0;
+	rss = usage.ru_maxrss;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* return the word following key in the program output, "" if key isn't there */
+string find_value(string& out, string key) {
+	size_t pos = out.find(key);
+	if( pos == string::npos ) return "";
+	istringstream rest( out.substr(pos + key.size()) );
+	string value;
+	rest >> value;
+	return value;
+}
+
+/* return the p-th percentile, 0 to 1, of a list of times, by nearest rank */
+double percentile(vector<double> times, double p) {
+	if( times.empty() ) return 0;
+	sort( times.begin(), times.end() );
+	int rank = (int)(p*times.size() + 0.999999);
+	if( rank < 1 ) rank = 1;
+	return times[rank-1];
+}
+
+/*
+	Time the full preprocessing of a wordlist, all 3 files and the index,
+	written to dir.  Throughput is in wordlist lines per second
+*/
+void bench_preproc(Case& c, string wordlist, string dir, int repeats) {
+	ifstream infile(wordlist.c_str());
+	if( !infile ) {
+		cout << "ERROR: cannot open wordlist " << wordlist << endl;
+		exit(-1);
+	}
+	string line;
+	c.items = 0;
+	while( getline(infile, line) ) c.items++;
+
+	vector<string> args = { "./preproc", wordlist, dir+"/dict", dir+"/regs", dir+"/matches", dir+"/index" };
+	c.peak_rss = 0;
+	c.solutions = 0;
+	c.nodes = 0;
+	for(int r=0; r<repeats; r++) {
+		string out;
+		double ms;
+		long rss;
+		if( !run_process(args, out, ms, rss) ) {
+			cout << "ERROR: preprocessing failed:" << endl << out << endl;
+			exit(-1);
+		}
+		c.wall.push_back(ms);
+		c.peak_rss = max(c.peak_rss, rss);
+	}
+}
+
+/*
+	Time the wordsquare program on one seed set, writing to /dev/null.
+	One untimed run first brings the index into the page cache
+*/
+void bench_solver(Case& c, string index, vector<string>& opts, string dir, int repeats) {
+	string seedfile = dir + "/seeds.txt";
+	ofstream seeds(seedfile.c_str());
+	for(unsigned i=0; i<c.seeds.size(); i++) seeds << c.seeds[i] << endl;
+	seeds.close();
+
+	vector<string> args = { "./wordsquares" };
+	args.insert( args.end(), opts.begin(), opts.end() );
+	args.push_back(index);
+	args.push_back(seedfile);
+	args.push_back("/dev/null");
+
+	c.peak_rss = 0;
+	c.items = 0;
+	for(int r=-1; r<repeats; r++) {
+		string out;
+		double ms;
+		long rss;
+		if( !run_process(args, out, ms, rss) ) {
+			cout << "ERROR: wordsquares failed on " << c.name << ":" << endl << out << endl;
+			exit(-1);
+		}
+		if( r < 0 ) continue;
+		c.wall.push_back(ms);
+		c.search.push_back( atof( find_value(out, "elapsed time calculating wordsqurare:").c_str() ) * 1000 );
+		c.solutions = atol( find_value(out, "generated:").c_str() );
+		c.nodes = atol( find_value(out, "searched").c_str() );
+		c.peak_rss = max(c.peak_rss, rss);
+	}
+}
+
+/*
+	Read the seed sets of the corpus, one per line as in a --batch list.
+	Cases are named by their number of seed words and their place in that group
+*/
+vector<Case> read_corpus(string corpus) {
+	ifstream infile(corpus.c_str());
+	if( !infile ) {
+		cout << "ERROR: cannot open corpus " << corpus << endl;
+		exit(-1);
+	}
+	vector<Case> cases;
+	map<int, int> groupsize;
+	string line;
+	while( getline(infile, line) ) {
+		Case c;
+		istringstream words(line);
+		string word;
+		while( words >> word ) c.seeds.push_back(word);
+		if( c.seeds.empty() || c.seeds[0][0] == '#' ) continue;
+		c.numseeds = c.seeds.size();
+		c.name = "seeds" + to_string(c.numseeds) + "-" + to_string( ++groupsize[c.numseeds] );
+		cases.push_back(c);
+	}
+	return cases;
+}
+
+/*
+	Print each case, then each group of seed sets with the same
+	number of seed words, over all the runs of the group
+*/
+void print_table(vector<Case>& cases) {
+	char row[256];
+	cout << endl;
+	snprintf(row, sizeof(row), "%-12s %10s %10s %10s %10s %12s %14s %12s %10s",
+		"case", "wall med", "wall p95", "search med", "search p95", "solutions", "nodes/s", "solutions/s", "rss KB");
+	cout << row << endl;
+
+	map<int, vector<double> > groups;
+	for(unsigned i=0; i<cases.size(); i++) {
+		Case& c = cases[i];
+		if( c.numseeds == 0 ) {
+			double sec = percentile(c.wall, 0.5) / 1000;
+			snprintf(row, sizeof(row), "%-12s %10.2f %10.2f %10s %10s %12s %14s %12s %10ld",
+				c.name.c_str(), percentile(c.wall, 0.5), percentile(c.wall, 0.95), "-", "-", "-", "-", "-", c.peak_rss);
+			cout << row << endl;
+			cout << "             " << (long)(c.items / sec) << " wordlist lines/s" << endl;
+			continue;
+		}
+		double sec = max( percentile(c.search, 0.5), 0.001 ) / 1000;
+		snprintf(row, sizeof(row), "%-12s %10.2f %10.2f %10.2f %10.2f %12ld %14.0f %12.0f %10ld",
+			c.name.c_str(), percentile(c.wall, 0.5), percentile(c.wall, 0.95),
+			percentile(c.search, 0.5), percentile(c.search, 0.95),
+			c.solutions, c.nodes / sec, c.solutions / sec, c.peak_rss);
+		cout << row << endl;
+		groups[c.numseeds].insert( groups[c.numseeds].end(), c.wall.begin(), c.wall.end() );
+	}
+
+	cout << endl << "# seed words | wall med | wall p95   (ms, all runs of the group)" << endl;
+	for(auto it = groups.rbegin(); it != groups.rend(); it++) {
+		snprintf(row, sizeof(row), "%-12d | %8.2f | %8.2f", it->first,
+			percentile(it->second, 0.5), percentile(it->second, 0.95));
+		cout << row << endl;
+	}
+}
+
+/*
+	Write every case as JSON, one case object per line of the cases array,
+	times in ms and memory in KB
+*/
+void write_json(vector<Case>& cases, string jsonfile, int repeats) {
+	ofstream out(jsonfile.c_str());
+	if( !out ) {
+		cout << "ERROR: cannot write " << jsonfile << endl;
+		return;
+	}
+	char num[64];
+	auto fmt = [&num](double d) { snprintf(num, sizeof(num), "%.3f", d); return string(num); };
+
+	out << "{\"repeats\":" << repeats << ",\"cases\":[" << endl;
+	for(unsigned i=0; i<cases.size(); i++) {
+		Case& c = cases[i];
+		out << "{\"name\":\"" << c.name << "\",\"seeds\":[";
+		for(unsigned j=0; j<c.seeds.size(); j++) out << (j ? "," : "") << "\"" << c.seeds[j] << "\"";
+		out << "],\"wall_median_ms\":" << fmt(percentile(c.wall, 0.5));
+		out << ",\"wall_p95_ms\":" << fmt(percentile(c.wall, 0.95));
+		if( c.numseeds == 0 ) {
+			out << ",\"lines_per_s\":" << fmt(c.items / (percentile(c.wall, 0.5)/1000));
+		} else {
+			double sec = max( percentile(c.search, 0.5), 0.001 ) / 1000;
+			out << ",\"search_median_ms\":" << fmt(percentile(c.search, 0.5));
+			out << ",\"search_p95_ms\":" << fmt(percentile(c.search, 0.95));
+			out << ",\"solutions\":" << c.solutions << ",\"nodes\":" << c.nodes;
+			out << ",\"nodes_per_s\":" << fmt(c.nodes / sec);
+			out << ",\"solutions_per_s\":" << fmt(c.solutions / sec);
+		}
+		out << ",\"peak_rss_kb\":" << c.peak_rss << "}" << (i+1 < cases.size() ? "," : "") << endl;
+	}
+	out << "]}" << endl;
+	cout << endl << "wrote results to " << jsonfile << endl;
+}
+
+/*
+	Compare the results of two runs, as written by write_json,
+	printing the median times of each case and the change from the first.
+	Only reads the one case per line layout that write_json writes
+*/
+int compare(string before, string after) {
+	map<string, map<string, double> > runs[2];
+	vector<string> order;
+	string files[2] = { before, after };
+	for(int f=0; f<2; f++) {
+		ifstream in(files[f].c_str());
+		if( !in ) {
+			cout << "ERROR: cannot open " << files[f] << endl;
+			return -1;
+		}
+		string line;
+		while( getline(in, line) ) {
+			string name = find_value(line, "{\"name\":\"");
+			if( name.empty() ) continue;
+			name = name.substr(0, name.find('"'));
+			if( f == 0 ) order.push_back(name);
+			const char* keys[] = { "wall_median_ms", "search_median_ms", "peak_rss_kb" };
+			for(int k=0; k<3; k++) {
+				size_t pos = line.find( string("\"") + keys[k] + "\":" );
+				if( pos == string::npos ) continue;
+				runs[f][name][keys[k]] = atof( line.c_str() + pos + strlen(keys[k]) + 3 );
+			}
+		}
+	}
+
+	char row[256];
+	snprintf(row, sizeof(row), "%-12s %12s %12s %8s %12s %12s %8s",
+		"case", "wall before", "wall after", "change", "search bef", "search aft", "change");
+	cout << row << endl;
+	for(unsigned i=0; i<order.size(); i++) {
+		string name = order[i];
+		if( !runs[1].count(name) ) continue;
+		map<string, double>& a = runs[0][name];
+		map<string, double>& b = runs[1][name];
+		auto change = [](double x, double y) { return x > 0 ? 100*(y-x)/x : 0.0; };
+		snprintf(row, sizeof(row), "%-12s %12.2f %12.2f %7.1f%% %12.2f %12.2f %7.1f%%", name.c_str(),
+			a["wall_median_ms"], b["wall_median_ms"], change(a["wall_median_ms"], b["wall_median_ms"]),
+			a["search_median_ms"], b["search_median_ms"], change(a["search_median_ms"], b["search_median_ms"]));
+		cout << row << endl;
+	}
+	return 0;
+}
+
+/* print program usage */
+void usage() {
+	cout << "usage: ./wsbench  [-r repeats]  [-o results.json]  [-w wordlist]  [-i index]  [-s corpus]  [-- wordsquares options]" << endl;
+	cout << "       ./wsbench  --compare  before.json  after.json" << endl;
+	cout << "defaults: 5 repeats, bench/results.json, the sample wordlist and index, bench/corpus.list" << endl;
+}
@@ -0,0 +1,97 @@
+/*
+	Binary index file layout, wsindex.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Shared by the preprocessing program, which writes the index,
+	and the wordsquare program, which memory maps it.
+
+	The index holds the same data as the dict, regs, and matches text files,
+	stored so it can be used in place without any parsing:
+		- a fixed size header, described below
+		- the word table, numwords entries of wordlen characters, no terminators
+		- the pattern table, numregs entries of wordlen characters, sorted
+		- csc1, numregs+1 32-bit ints
+		- csc2, nnz 32-bit ints
+		- the word weights, numwords 32-bit ints, only if the wordlist had weights
+	Each section starts on an 8 byte boundary.
+	The checksum covers every byte after the header, the header's
+	counts and offsets are checked against the file size instead.
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef WSINDEX_HPP
+#define WSINDEX_HPP
+
+#include <stdint.h>
+#include <string.h>
+
+#define WSINDEX_MAGIC "WSINDEX"
+#define WSINDEX_VERSION 2
+
+struct IndexHeader {
+	char magic[8];			// WSINDEX_MAGIC, null terminated
+	uint32_t version;		// WSINDEX_VERSION
+	uint32_t wordlen;		// characters per word and per pattern
+	uint32_t numwords;		// entries in the word table
+	uint32_t numregs;		// entries in the pattern table
+	uint64_t nnz;			// entries in csc2
+	uint64_t words_off;		// byte offsets of each section from the start of the file
+	uint64_t regs_off;
+	uint64_t csc1_off;
+	uint64_t csc2_off;
+	uint64_t weights_off;	// 0 if there are no weights
+	uint64_t filesize;		// total size of the file in bytes
+	uint64_t checksum;		// FNV-1a over bytes [sizeof(IndexHeader), filesize)
+};
+
+/*
+	Pattern character codes, shared by the preprocessing program,
+	which groups patterns by their packed codes, and the Regs lookup.
+	Each character is coded in KEYBITS bits,
+	'*' as 0, '-' as 1, and 'a' through 'z' as 2 through 27
+*/
+#define KEYBITS 5
+
+inline unsigned key_code(char c) {
+	if( c == '*' ) return 0;
+	if( c == '-' ) return 1;
+	return c - 'a' + 2;
+}
+
+/* inverse of key_code() */
+inline char code_char(unsigned code) {
+	if( code == 0 ) return '*';
+	if( code == 1 ) return '-';
+	return 'a' + code - 2;
+}
+
+/*
+	pack a pattern of wordlen characters into an integer key,
+	the first character in the most significant bits
+*/
+inline uint64_t pattern_key(const char* reg, int wordlen) {
+	uint64_t key = 0;
+	for(int i=0; i<wordlen; i++) {
+		key = (key << KEYBITS) | key_code(reg[i]);
+	}
+	return key;
+}
+
+/* round a section offset up to the next 8 byte boundary */
+inline uint64_t index_align(uint64_t off) {
+	return (off + 7) & ~(uint64_t)7;
+}
+
+/* 64-bit FNV-1a hash, used as the index checksum */
+inline uint64_t index_checksum(const char* data, uint64_t len) {
+	uint64_t h = 14695981039346656037ULL;
+	for(uint64_t i=0; i<len; i++) {
+		h ^= (unsigned char)data[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+#endif
@@ -7,16 +7,46 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <climits>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_set>
+#include <deque>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
 #include "sys/time.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <condition_variable>
+#include <cerrno>
+#include <sys/wait.h>
+#include <sys/resource.h>
 
 using namespace std;
 
 typedef unsigned long long uint64;
 
-#define WORDLEN 5
+/*
+	Supported word lengths, the width of the square.
+	The search is compiled once for each length in this range,
+	and the length of the loaded wordlist picks one at runtime
+*/
+#define MINLEN 3
+#define MAXLEN 8
 
 /*
 struct Bits{
@@ -31,8 +61,24 @@ struct Bits{
 };
 */
 
+#include "wsindex.hpp"
+
+#include "Options.hpp"
+#include "Index.hpp"
 #include "Dict.hpp"
 #include "Regs.hpp"
 #include "Matches.hpp"
+#include "Bitsets.hpp"
+#include "Stats.hpp"
+#include "Allocs.hpp"
+#include "Nogoods.hpp"
 #include "Square.hpp"
-#include "Squares.hpp"
\ No newline at end of file
+#include "Trie.hpp"
+#include "Scheduler.hpp"
+#include "Writer.hpp"
+#include "Seen.hpp"
+#include "Checkpoint.hpp"
+#include "Coordinator.hpp"
+#include "Squares.hpp"
+#include "Server.hpp"
+#include "Batch.hpp"
\ No newline at end of file
@@ -14,81 +14,469 @@
 using namespace std;
 
 uint64 getTime();
+void usage();
+template<int N> long run_squares(Options&, Dict*, Regs*, Matches*, Bitsets*, Trie*, Stats*, Checkpoint*, string, string);
+template<int N> long run_batch(Options&, Dict*, Regs*, Matches*, Bitsets*, Trie*, string, string);
+template<int N> void run_server(Options&, Dict*, Regs*, Matches*, Bitsets*, Trie*, string, int);
 
 int main(int argc, char* argv[]) {
 
-	/* usage */
-	if( argc != 6 ) {
-		cout << "usage: ./squares  dict  regs  matches  seeds  outfile" << endl;
+	/* options, then filenames as program input */
+	Options opts;
+	opts.engine = "csc";
+	opts.numthreads = 1;
+	opts.ordered = false;
+	opts.forward_check = true;
+	opts.dynamic_order = true;
+	opts.root_ac = true;
+	opts.format = "text";
+	opts.dedupe = false;
+	opts.max_solutions = 0;
+	opts.deadline = 0;
+	opts.max_per_seed = 0;
+	opts.numprocs = 1;
+	opts.worker_mem = 0;
+	opts.nogood_mb = 0;
+	opts.top = 0;
+	opts.seed_tree = false;
+	string serve = "";
+	string batch = "";
+	string statsfile = "";
+	string checkpointfile = "";
+	string resumefile = "";
+	long checkpoint_every = 60;
+	int poolsize = thread::hardware_concurrency();
+	if( poolsize < 1 ) poolsize = 1;
+	vector<string> files;
+	for(int i=1; i<argc; i++) {
+		string arg = argv[i];
+		if( arg == "--engine" && i+1<argc ) {
+			opts.engine = argv[++i];
+		} else if( arg == "-j" && i+1<argc ) {
+			opts.numthreads = atoi(argv[++i]);
+		} else if( arg == "--ordered" ) {
+			opts.ordered = true;
+		} else if( arg == "--no-fc" ) {
+			opts.forward_check = false;
+		} else if( arg == "--static-order" ) {
+			opts.dynamic_order = false;
+		} else if( arg == "--no-ac" ) {
+			opts.root_ac = false;
+		} else if( arg == "--seed-tree" ) {
+			opts.seed_tree = true;
+		} else if( arg == "--dedupe" ) {
+			opts.dedupe = true;
+		} else if( arg == "--keep-duplicates" ) {
+			opts.dedupe = false;
+		} else if( arg == "--format" && i+1<argc ) {
+			opts.format = argv[++i];
+		} else if( arg == "--serve" && i+1<argc ) {
+			serve = argv[++i];
+		} else if( arg == "--max-solutions" && i+1<argc ) {
+			opts.max_solutions = atol(argv[++i]);
+		} else if( arg == "--deadline" && i+1<argc ) {
+			opts.deadline = atol(argv[++i]);
+		} else if( arg == "--max-per-seed" && i+1<argc ) {
+			opts.max_per_seed = atol(argv[++i]);
+		} else if( arg == "--stats" && i+1<argc ) {
+			statsfile = argv[++i];
+		} else if( arg == "--procs" && i+1<argc ) {
+			opts.numprocs = atoi(argv[++i]);
+		} else if( arg == "--worker-mem" && i+1<argc ) {
+			opts.worker_mem = atol(argv[++i]);
+		} else if( arg == "--nogood-mb" && i+1<argc ) {
+			opts.nogood_mb = atol(argv[++i]);
+		} else if( arg == "--top" && i+1<argc ) {
+			opts.top = atol(argv[++i]);
+		} else if( arg == "--checkpoint" && i+1<argc ) {
+			checkpointfile = argv[++i];
+		} else if( arg == "--checkpoint-every" && i+1<argc ) {
+			checkpoint_every = atol(argv[++i]);
+		} else if( arg == "--resume" && i+1<argc ) {
+			resumefile = argv[++i];
+		} else if( arg == "--batch" && i+1<argc ) {
+			batch = argv[++i];
+		} else if( arg == "--pool" && i+1<argc ) {
+			poolsize = atoi(argv[++i]);
+		} else if( arg.size()>1 && arg[0]=='-' ) {
+			usage();
+			return -1;
+		} else {
+			files.push_back(arg);
+		}
 	}
 
-	/* filenames as program input */
-	string dictfile = argv[1];
-	string regsfile = argv[2];
-	string matchfile = argv[3];
-	string seedfile = argv[4];
-	string outfile = argv[5];
+	/* 
+		usage, a server takes its seeds from queries, so has no seeds or outfile,
+		and a batch takes its seeds from the batch list
+	*/
+	int numtables = !serve.empty() ? (int)files.size() : !batch.empty() ? (int)files.size()-1 : (int)files.size()-2;
+	if( (numtables != 3 && numtables != 1) || poolsize < 1 || (!serve.empty() && !batch.empty()) || (opts.engine != "csc" && opts.engine != "bitset" && opts.engine != "trie") 
+		|| opts.numthreads < 1 || opts.numprocs < 1 || opts.worker_mem < 0 || opts.nogood_mb < 0 || opts.top < 0 || opts.max_solutions < 0 || opts.deadline < 0 || opts.max_per_seed < 0 || checkpoint_every < 1 || (opts.format != "text" && opts.format != "ndjson") ) {
+		usage();
+		return -1;
+	}
+
+	/* 
+		with 1 table file it is either a binary index, 
+		or with the bitset or trie engine possibly a plain dict file
+	*/
+	bool use_bitsets = (opts.engine == "bitset");
+	bool use_trie = (opts.engine == "trie");
+	bool use_index = numtables==3 ? false : Index::is_index_file(files[0]);
+	if( numtables==1 && !use_index && !use_bitsets && !use_trie ) {
+		cout << "ERROR: " << files[0] << " is not a binary index" << endl;
+		cout << "a dict file alone is only enough with --engine bitset or trie" << endl;
+		return -1;
+	}
+	string seedfile = numtables+2 == (int)files.size() ? files[files.size()-2] : batch;
+	string outfile = serve.empty() ? files[files.size()-1] : "";
+
+	/* 
+		search statistics, only in a build with WS_STATS, for a single run.
+		Started before any other thread, see Stats.hpp
+	*/
+	Stats* stats = NULL;
+#ifdef WS_STATS
+	if( serve.empty() && batch.empty() ) {
+		stats = new Stats( statsfile.empty() ? "stats.json" : statsfile );
+	}
+#else
+	if( !statsfile.empty() ) {
+		cout << "ERROR: --stats needs a build with search statistics, make -B STATS=1" << endl;
+		return -1;
+	}
+#endif
+
+	/* a search split between worker processes, see Coordinator.hpp */
+	if( opts.numprocs > 1 && (!serve.empty() || !batch.empty() || opts.numthreads > 1 || use_trie 
+		|| !checkpointfile.empty() || !resumefile.empty()) ) {
+		cout << "ERROR: --procs is only for a single run with -j 1 and the csc or bitset engine, without checkpoints" << endl;
+		return -1;
+	}
+
+	/* seedwords placed by the search, see Section 7.17 */
+	if( opts.seed_tree && use_trie ) {
+		cout << "ERROR: --seed-tree is only for the csc and bitset engines" << endl;
+		return -1;
+	}
+
+	/* a scored search for the best squares, see Section 7.16 */
+	if( opts.top > 0 && (!serve.empty() || !batch.empty() || opts.numthreads > 1 || opts.numprocs > 1 || opts.engine != "csc"
+		|| !checkpointfile.empty() || !resumefile.empty() || opts.max_solutions > 0 || opts.max_per_seed > 0 || opts.nogood_mb > 0) ) {
+		cout << "ERROR: --top is only for a single run with -j 1 and the csc engine," << endl;
+		cout << "without checkpoints, --max-solutions, --max-per-seed, or --nogood-mb" << endl;
+		return -1;
+	}
+
+	/*
+		a checkpoint, to save the search to or to resume it from, and keep saving it to.
+		Only a single run on one thread with the regex engines, writing to a file,
+		can be continued.  Read before anything is loaded, so a bad one fails fast
+	*/
+	Checkpoint* checkpoint = NULL;
+	if( !checkpointfile.empty() || !resumefile.empty() ) {
+		if( !checkpointfile.empty() && !resumefile.empty() ) {
+			cout << "ERROR: --resume keeps saving to the checkpoint it resumes, drop --checkpoint" << endl;
+			return -1;
+		}
+		if( !serve.empty() || !batch.empty() || opts.numthreads > 1 || use_trie || outfile == "-" ) {
+			cout << "ERROR: checkpoints are only for a single run with -j 1, the csc or bitset engine, and an outfile" << endl;
+			return -1;
+		}
+		if( !resumefile.empty() ) {
+			checkpoint = new Checkpoint(resumefile, checkpoint_every);
+			checkpoint->read();
+			if( checkpoint->outfile != outfile || checkpoint->format != opts.format ) {
+				cout << "ERROR: checkpoint " << resumefile << " was writing " << checkpoint->format;
+				cout << " to " << checkpoint->outfile << ", give the same outfile and --format" << endl;
+				return -1;
+			}
+		} else {
+			checkpoint = new Checkpoint(checkpointfile, checkpoint_every);
+		}
+	}
+
+	/* when squares are written to stdout, progress messages go to stderr */
+	if( outfile == "-" ) {
+		cout.rdbuf( cerr.rdbuf() );
+	}
 
 	uint64 start_total = getTime();
 
-	/* load and assign wordlist and regex structures */
+	/* 
+		load and assign wordlist and regex structures,
+		either mapped in place from a binary index or parsed from the text files.
+		The bitset and trie engines are built from the wordlist alone
+	*/
 	cout << endl << "loading files..." << endl << endl;
-	Dict dict(dictfile);
-	Regs regs(regsfile);
-	Matches matches(matchfile);
-	Squares squares(seedfile);
-	
-	squares.set_dict(&dict);
-	squares.set_regs(&regs);	
-	squares.set_matches(&matches);
-	squares.set_outfile_name(outfile);
+	Index* index = NULL;
+	Dict* dict;
+	Regs* regs = NULL;
+	Matches* matches = NULL;
+	Bitsets* bitsets = NULL;
+	Trie* trie = NULL;
+	bool use_csc = !use_bitsets && !use_trie;
+	if( use_index ) {
+		index = new Index(files[0]);
+		dict = new Dict(index);
+		if( use_csc ) {
+			regs = new Regs(index);
+			matches = new Matches(index);
+		}
+	} else {
+		dict = new Dict(files[0]);
+		if( use_csc ) {
+			regs = new Regs(files[1]);
+			matches = new Matches(files[2]);
+		}
+	}
+	if( use_bitsets ) {
+		bitsets = new Bitsets(dict);
+	}
+	if( use_trie ) {
+		trie = new Trie(dict);
+	}
 	cout << "...all files loaded" << endl << endl;
 
 	/* assign matches matrix dimensions */
-	matches.set_numwords( dict.get_size() );
-	matches.set_numregs( regs.get_size() );
+	if( matches != NULL ) {
+		matches->set_numwords( dict->get_size() );
+		matches->set_numregs( regs->get_size() );
+	}
 
-	/* generate all possible seed square configurations */
-	squares.generate_seedsquares();
-	cout << "generated " << squares.get_numsquares() << " seedsquares" << endl;
-	int sdsqrs = squares.get_numsquares();
-	
-	/* generate all possible wordsquares */
+	/* the largest word weight of every regex, to bound the scores of --top */
+	if( opts.top > 0 ) {
+		if( !dict->has_weights() ) {
+			cout << "ERROR: --top needs word weights, preprocess the wordlist with -w" << endl;
+			return -1;
+		}
+		matches->set_weights( dict->get_weights() );
+	}
+
+	/*
+		or answer queries until stopped, with the search compiled
+		for the word length of the wordlist
+	*/
+	if( !serve.empty() ) {
+		switch( dict->get_wordlen() ) {
+			case 3: run_server<3>(opts, dict, regs, matches, bitsets, trie, serve, poolsize); break;
+			case 4: run_server<4>(opts, dict, regs, matches, bitsets, trie, serve, poolsize); break;
+			case 5: run_server<5>(opts, dict, regs, matches, bitsets, trie, serve, poolsize); break;
+			case 6: run_server<6>(opts, dict, regs, matches, bitsets, trie, serve, poolsize); break;
+			case 7: run_server<7>(opts, dict, regs, matches, bitsets, trie, serve, poolsize); break;
+			case 8: run_server<8>(opts, dict, regs, matches, bitsets, trie, serve, poolsize); break;
+			default:
+				cout << "ERROR: word length " << dict->get_wordlen() << " is not supported" << endl;
+				return -1;
+		}
+	}
+
+	/* 
+		generate all possible wordsquares, of the seeds file or of every
+		seed set in the batch list, with the search compiled 
+		for the word length of the wordlist,
+		streaming them to the given output file as they are found
+	*/
 	uint64 start_ws_proc = getTime();
-	squares.generate_wordsquares();
-	int foundsquares = squares.get_numsquares() - sdsqrs;
-	cout << "generated: " << foundsquares << " wordsquares" << endl;	
-	
-	/* write complete wordsquares to given output file */
+	long foundsquares = 0;
+	if( !batch.empty() ) {
+		switch( dict->get_wordlen() ) {
+			case 3: foundsquares = run_batch<3>(opts, dict, regs, matches, bitsets, trie, seedfile, outfile); break;
+			case 4: foundsquares = run_batch<4>(opts, dict, regs, matches, bitsets, trie, seedfile, outfile); break;
+			case 5: foundsquares = run_batch<5>(opts, dict, regs, matches, bitsets, trie, seedfile, outfile); break;
+			case 6: foundsquares = run_batch<6>(opts, dict, regs, matches, bitsets, trie, seedfile, outfile); break;
+			case 7: foundsquares = run_batch<7>(opts, dict, regs, matches, bitsets, trie, seedfile, outfile); break;
+			case 8: foundsquares = run_batch<8>(opts, dict, regs, matches, bitsets, trie, seedfile, outfile); break;
+			default:
+				cout << "ERROR: word length " << dict->get_wordlen() << " is not supported" << endl;
+				return -1;
+		}
+	} else {
+		switch( dict->get_wordlen() ) {
+			case 3: foundsquares = run_squares<3>(opts, dict, regs, matches, bitsets, trie, stats, checkpoint, seedfile, outfile); break;
+			case 4: foundsquares = run_squares<4>(opts, dict, regs, matches, bitsets, trie, stats, checkpoint, seedfile, outfile); break;
+			case 5: foundsquares = run_squares<5>(opts, dict, regs, matches, bitsets, trie, stats, checkpoint, seedfile, outfile); break;
+			case 6: foundsquares = run_squares<6>(opts, dict, regs, matches, bitsets, trie, stats, checkpoint, seedfile, outfile); break;
+			case 7: foundsquares = run_squares<7>(opts, dict, regs, matches, bitsets, trie, stats, checkpoint, seedfile, outfile); break;
+			case 8: foundsquares = run_squares<8>(opts, dict, regs, matches, bitsets, trie, stats, checkpoint, seedfile, outfile); break;
+			default:
+				cout << "ERROR: word length " << dict->get_wordlen() << " is not supported" << endl;
+				return -1;
+		}
+	}
 	if(foundsquares==0) {
 		cout << "no squares found" << endl;
-	} else {
-		cout << "writing wordsquares to: " << outfile << endl;
-		squares.write_solved_squares();
-		cout << "wordsquares written" << endl;
 	}
 	
 	/* print runtime */	
-	cout << "elapsed time calculating wordsqurare: " << (float)(getTime() - start_ws_proc)/1000 << " s" << endl;
-	cout << "total elapsed time: " <<  (float)(getTime() - start_total)/1000 << " s" << endl;
+	cout << "elapsed time calculating wordsqurare: " << (double)(getTime() - start_ws_proc)/1000000 << " s" << endl;
+	cout << "total elapsed time: " <<  (double)(getTime() - start_total)/1000000 << " s" << endl;
+	ALLOC( cout << "allocations during the search: " << alloc_count() << endl; )
 
+	if( stats != NULL ) stats->close();
+	delete stats;
+	delete checkpoint;
+	delete trie;
+	delete bitsets;
+	delete matches;
+	delete regs;
+	delete dict;
+	delete index;
+
+	ALLOC( if( alloc_count() > 0 ) return 1; )
 	return 0;
 
 }
 
 
 /*
-	get current time, for timing
+	Generate the seedsquares and the wordsquares of width N,
+	writing the wordsquares to outfile.  Return the number written.
+	With a checkpoint the search is saved as it goes, and a resumed
+	checkpoint continues the outfile where it left off
+*/
+template<int N>
+long run_squares(Options& opts, Dict* dict, Regs* regs, Matches* matches, Bitsets* bitsets, Trie* trie, Stats* stats, Checkpoint* checkpoint, string seedfile, string outfile) {
+
+	Squares<N> squares(seedfile);
+	
+	squares.set_dict(dict);
+	squares.set_regs(regs);	
+	squares.set_matches(matches);
+	squares.set_bitsets(bitsets);
+	squares.set_trie(trie);
+	squares.set_options(opts);
+	squares.set_stats(stats);
+	squares.set_checkpoint(checkpoint);
+
+	/* generate all possible seed square configurations */
+	squares.generate_seedsquares();
+	cout << "generated " << squares.get_numsquares() << " seedsquares" << endl;
+
+	cout << "writing " << N << "x" << N << " wordsquares to: " << outfile << endl;
+	Writer::catch_interrupt();
+	Writer* writer;
+	if( checkpoint != NULL && checkpoint->resumed ) {
+		writer = new Writer(outfile, opts.format, N, checkpoint->count, checkpoint->offset);
+	} else {
+		writer = new Writer(outfile, opts.format, N);
+	}
+	if( checkpoint != NULL ) {
+		checkpoint->outfile = outfile;
+		checkpoint->format = opts.format;
+	}
+	squares.set_writer(writer);
+	squares.generate_wordsquares();
+	writer->close();
+	int error = writer->get_error();
+	delete writer;
+	if( error != 0 ) {
+		cout << "ERROR: cannot write wordsquares to " << outfile << ": " << strerror(error) << endl;
+		cout << "exiting program" << endl;
+		exit(-1);
+	}
+	long foundsquares = squares.get_numfound();
+	cout << "generated: " << foundsquares << " wordsquares" << endl;	
+	cout << "searched " << squares.get_numnodes() << " nodes" << endl;
+	if( opts.nogood_mb > 0 && opts.engine != "trie" && opts.numprocs == 1 ) {
+		cout << squares.get_nogood_stats() << endl;
+	}
+	if( opts.top > 0 ) {
+		cout << squares.get_top_stats() << endl;
+	}
+	if( opts.dedupe ) {
+		cout << "dropped " << squares.get_numduplicates() << " duplicate wordsquares" << endl;
+	}
+	cout << "search " << squares.get_status() << endl;
+	return foundsquares;
+}
+
+/*
+	Solve every seed set of the batch list for squares of width N,
+	running -j of them at once, each on one thread.
+	Print a summary of the queries and return the number of squares written
+*/
+template<int N>
+long run_batch(Options& opts, Dict* dict, Regs* regs, Matches* matches, Bitsets* bitsets, Trie* trie, string listfile, string outfile) {
+
+	Batch<N> batch(listfile, opts);
+
+	batch.set_dict(dict);
+	batch.set_regs(regs);
+	batch.set_matches(matches);
+	batch.set_bitsets(bitsets);
+	batch.set_trie(trie);
+
+	long foundsquares = batch.run(outfile, opts.numthreads);
+	batch.print_summary();
+	return foundsquares;
+}
+
+/*
+	Answer seed queries for squares of width N on the socket at path,
+	sharing the loaded tables between poolsize threads.  Does not return
+*/
+template<int N>
+void run_server(Options& opts, Dict* dict, Regs* regs, Matches* matches, Bitsets* bitsets, Trie* trie, string path, int poolsize) {
+
+	Server<N> server(path, poolsize, opts);
+
+	server.set_dict(dict);
+	server.set_regs(regs);
+	server.set_matches(matches);
+	server.set_bitsets(bitsets);
+	server.set_trie(trie);
+	server.run();
+}
+
+/* print program usage */
+void usage() {
+	cout << "usage: ./squares  [options]  dict  regs  matches  seeds  outfile" << endl;
+	cout << "       ./squares  [options]  index  seeds  outfile" << endl;
+	cout << "       ./squares  [options]  --engine bitset|trie  dict  seeds  outfile" << endl;
+	cout << "       ./squares  [options]  --batch seeds.list  dict  regs  matches | index | dict  outfile" << endl;
+	cout << "       ./squares  [options]  --serve socket  dict  regs  matches | index | dict" << endl;
+	cout << "options:" << endl;
+	cout << "  --engine csc|bitset|trie" << endl;
+	cout << "                        find candidate words with the matches matrix (default)" << endl;
+	cout << "                        or with per-position bitsets built from the dict," << endl;
+	cout << "                        or fill rows in order with a trie built from the dict" << endl;
+	cout << "  -j N                  search on N threads (default 1)" << endl;
+	cout << "  --ordered             with -j, write squares in single threaded order" << endl;
+	cout << "  --no-fc               turn off forward checking with letter domains" << endl;
+	cout << "  --static-order        fill word positions in index order, not most constrained first" << endl;
+	cout << "  --no-ac               skip the arc consistency pass on seedsquares" << endl;
+	cout << "  --seed-tree           trade seedsquares for placing seedwords in the search: only the first is" << endl;
+	cout << "                        placed in the seedsquares; usually searches as many nodes, not a speedup" << endl;
+	cout << "  --format text|ndjson  output format (default text), outfile - writes to stdout" << endl;
+	cout << "  --dedupe              drop a square if it or its transpose was written, memory grows with the squares" << endl;
+	cout << "  --keep-duplicates     write every square found, even if it or its transpose was written, the default" << endl;
+	cout << "  --max-solutions K     stop after writing K wordsquares" << endl;
+	cout << "  --deadline MS         stop the search MS milliseconds after it starts" << endl;
+	cout << "  --max-per-seed K      write at most K wordsquares from each seedsquare" << endl;
+	cout << "  --stats file          in a make STATS=1 build, write search statistics here (default stats.json)," << endl;
+	cout << "                        at the end and on SIGUSR1" << endl;
+	cout << "  --procs P             split the search into shards for P worker processes, csc or bitset only" << endl;
+	cout << "  --worker-mem MB       with --procs, limit each worker process to MB of address space" << endl;
+	cout << "  --top K               write only the K squares whose words weigh the most, best first," << endl;
+	cout << "                        with a wordlist preprocessed with -w, csc only" << endl;
+	cout << "  --nogood-mb MB        skip partial squares already searched without a solution," << endl;
+	cout << "                        remembered in a table of MB megabytes, csc or bitset only" << endl;
+	cout << "  --checkpoint file     save the search to file every 60 s and on SIGTERM, -j 1 with csc or bitset only" << endl;
+	cout << "  --checkpoint-every S  save the checkpoint every S seconds" << endl;
+	cout << "  --resume file         continue the search saved in the checkpoint file, with the same arguments" << endl;
+	cout << "  --batch seeds.list    solve every seed set in the list, one per line, -j at a time;" << endl;
+	cout << "                        outfile is one output tagged by query, or a directory for a file per query" << endl;
+	cout << "  --serve socket        answer seed queries on a unix domain socket, see the README" << endl;
+	cout << "  --pool N              with --serve, answer up to N connections at once (default one per core)" << endl;
+}
+
+/*
+	get current time in microseconds, for timing.
+	Uses the monotonic clock, so runtimes can't jump with the wall clock
 */
 uint64 getTime()
 {
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  uint64 ret = tv.tv_usec;
-  // convert micro secs (10^-6) to millisecs (10^-3)
-  ret /= 1000;
-  
-  // add seconds (10^0) after converting to millisecs (10^-3)
-  ret += (tv.tv_sec*1000);
-  return ret;
+  return chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
 }
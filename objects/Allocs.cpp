@@ -0,0 +1,69 @@
+/*
+	Allocation counting implementation, Allocs.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Replaces the global operator new and delete with malloc and free.
+	The aligned and nothrow forms are left to the library,
+	nothing in the search uses them
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+#ifdef WS_ALLOCS
+
+static atomic<long> numallocs(0);
+static thread_local int watching = 0;	// nesting depth of watches on this thread, 0 when paused
+
+void* operator new(size_t size) {
+	if( watching > 0 ) numallocs.fetch_add(1, memory_order_relaxed);
+	void* p = malloc(size == 0 ? 1 : size);
+	if( p == NULL ) throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t size) noexcept {
+	free(p);
+}
+
+void operator delete[](void* p, size_t size) noexcept {
+	free(p);
+}
+
+AllocWatch::AllocWatch() {
+	watching++;
+}
+
+AllocWatch::~AllocWatch() {
+	watching--;
+}
+
+AllocPause::AllocPause() {
+	saved = watching;
+	watching = 0;
+}
+
+AllocPause::~AllocPause() {
+	watching = saved;
+}
+
+// return the allocations counted on every thread
+long alloc_count() {
+	return numallocs.load();
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+	Allocation counting header, Allocs.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Counts heap allocations made by the search, to check that
+	the search allocates nothing once it's set up.
+	The global operator new is replaced by one that counts its calls
+	from threads inside an AllocWatch, and gen_ws and gen_rows watch
+	every node.  Handing a square to the Writer, or keeping it for 
+	the merge of an ordered search, pauses the count.
+
+	Only compiled in with -DWS_ALLOCS, see make alloccheck,
+	the ALLOC() hooks in the search are empty otherwise
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef ALLOCS_HPP
+#define ALLOCS_HPP
+
+#ifdef WS_ALLOCS
+#define ALLOC(x) x
+
+/* count the allocations of this thread while in scope */
+struct AllocWatch {
+	AllocWatch();
+	~AllocWatch();
+};
+
+/* don't count them while in scope, inside a watch */
+struct AllocPause {
+	AllocPause();
+	~AllocPause();
+	int saved;
+};
+
+long alloc_count();
+
+#else
+#define ALLOC(x)
+#endif
+
+#endif
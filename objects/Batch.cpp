@@ -0,0 +1,271 @@
+/*
+	Batch runner implementation, Batch.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Queries are numbered from 1 in list order.  The pool threads
+	take the next query under a lock and run it with a Squares
+	of its own, so nothing but the Writer is shared during a search
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+// Read the seed sets of a list file, to be searched with opts
+template<int N>
+Batch<N>::Batch(string str, Options& o) {
+	listfile = str;
+	opts = o;
+	dict = NULL;
+	regs = NULL;
+	matches = NULL;
+	bitsets = NULL;
+	trie = NULL;
+	shared = NULL;
+	running_hard = 0;
+	max_hard = 1;
+	wall_ms = 0;
+	read_list();
+}
+
+/*
+	Read one seed set per line, its seed words separated by spaces.
+	Blank lines and lines starting with '#' are skipped.
+	Every set is checked before any is run, a bad one ends the program
+*/
+template<int N>
+void Batch<N>::read_list() {
+	cout << "reading batch list: " << listfile << endl;
+	ifstream infile(listfile.c_str());
+	if( !infile ) {
+		cout << "ERROR: cannot open batch list " << listfile << endl;
+		cout << "exiting program" << endl;
+		exit(-1);
+	}
+
+	string line;
+	int linenum = 0;
+	while( getline(infile, line) ) {
+		linenum++;
+		if( !line.empty() && line[line.size()-1] == '\r' ) line.erase(line.size()-1);
+		Query q;
+		q.line = linenum;
+		string word;
+		istringstream words(line);
+		while( words >> word ) q.seeds.push_back(word);
+		if( q.seeds.empty() || q.seeds[0][0] == '#' ) continue;
+
+		string error = Squares<N>::check_seedwords(q.seeds);
+		if( !error.empty() ) {
+			cout << "ERROR: line " << linenum << " of " << listfile << ": " << error << endl;
+			cout << "exiting program" << endl;
+			exit(-1);
+		}
+		q.hard = q.seeds.size() < BATCH_EASY;
+		q.found = 0;
+		q.ms = 0;
+		q.error = 0;
+		queries.push_back(q);
+	}
+	cout << "loaded " << queries.size() << " seed sets" << endl << endl;
+}
+
+/*
+	Run every query on poolsize threads, return the number of squares written.
+	If outfile is a directory each query writes query-K.txt there,
+	or query-K.ndjson, K its number.  Otherwise every square goes to
+	outfile, "-" for stdout, tagged with the number of its query
+*/
+template<int N>
+long Batch<N>::run(string outfile, int poolsize) {
+	auto start = chrono::steady_clock::now();
+
+	struct stat st;
+	if( stat(outfile.c_str(), &st) == 0 && S_ISDIR(st.st_mode) ) {
+		outdir = outfile;
+		cout << "writing " << N << "x" << N << " wordsquares of each query to: " << outdir << "/query-K" << endl;
+	} else {
+		shared = new Writer(outfile, opts.format, N);
+		cout << "writing " << N << "x" << N << " wordsquares of every query to: " << outfile << endl;
+	}
+
+	for(unsigned i=0; i<queries.size(); i++) {
+		if( queries[i].hard ) hard.push_back(i);
+		else easy.push_back(i);
+	}
+	if( poolsize > (int)queries.size() ) poolsize = max( (int)queries.size(), 1 );
+	max_hard = max( poolsize/2, 1 );
+	cout << "solving " << queries.size() << " queries, " << hard.size() << " with fewer than ";
+	cout << BATCH_EASY << " seed words, on " << poolsize << " threads" << endl;
+
+	vector<thread> pool;
+	for(int i=0; i<poolsize; i++) {
+		pool.push_back( thread(&Batch<N>::work, this) );
+	}
+	for(int i=0; i<poolsize; i++) {
+		pool[i].join();
+	}
+
+	long total = 0;
+	for(unsigned i=0; i<queries.size(); i++) total += queries[i].found;
+	int error = 0;
+	if( shared != NULL ) {
+		shared->close();
+		error = shared->get_error();
+		delete shared;
+		shared = NULL;
+	}
+
+	// squares that couldn't be written make the counts wrong, so the run fails
+	for(unsigned i=0; i<queries.size(); i++) {
+		if( queries[i].error == 0 ) continue;
+		cout << "ERROR: cannot write wordsquares to " << outdir << "/query-" << i+1;
+		cout << ": " << strerror(queries[i].error) << endl;
+		error = queries[i].error;
+	}
+	if( error != 0 ) {
+		if( outdir.empty() ) cout << "ERROR: cannot write wordsquares to " << outfile << ": " << strerror(error) << endl;
+		cout << "exiting program" << endl;
+		exit(-1);
+	}
+	wall_ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+	return total;
+}
+
+// pool thread loop, run queries until none are left
+template<int N>
+void Batch<N>::work() {
+	bool was_hard = false;
+	while( true ) {
+		int q = next_query(was_hard);
+		if( q < 0 ) return;
+		solve(q);
+	}
+}
+
+/*
+	Take the next query to run, -1 when none are left.
+	was_hard says whether the caller's last query was hard, and is set
+	for the one returned.  Hard queries go first, but only up to max_hard
+	of them run at once unless no easy ones are waiting
+*/
+template<int N>
+int Batch<N>::next_query(bool& was_hard) {
+	lock_guard<mutex> guard(lock);
+	if( was_hard ) running_hard--;
+	int q = -1;
+	if( !hard.empty() && (running_hard < max_hard || easy.empty()) ) {
+		q = hard.front();
+		hard.pop_front();
+		running_hard++;
+		was_hard = true;
+	} else if( !easy.empty() ) {
+		q = easy.front();
+		easy.pop_front();
+		was_hard = false;
+	} else {
+		was_hard = false;
+	}
+	return q;
+}
+
+// search one query on the calling thread and record its count and runtime
+template<int N>
+void Batch<N>::solve(int q) {
+	auto start = chrono::steady_clock::now();
+	Query& query = queries[q];
+
+	Squares<N> squares(query.seeds);
+	squares.set_dict(dict);
+	squares.set_regs(regs);
+	squares.set_matches(matches);
+	squares.set_bitsets(bitsets);
+	squares.set_trie(trie);
+	squares.set_options(opts);
+	squares.set_numthreads(1);
+	squares.set_verbose(false);
+
+	Writer* writer = shared;
+	if( outdir.size() > 0 ) {
+		string ext = opts.format == "ndjson" ? ".ndjson" : ".txt";
+		writer = new Writer(outdir + "/query-" + to_string(q+1) + ext, opts.format, N);
+	} else {
+		squares.set_tag(q+1);
+	}
+	squares.set_writer(writer);
+	squares.generate_seedsquares();
+	squares.generate_wordsquares();
+	if( writer != shared ) {
+		writer->close();
+		query.error = writer->get_error();
+		delete writer;
+	}
+
+	query.found = squares.get_numfound();
+	query.ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+}
+
+/*
+	Print a table of every query with its line in the list, 
+	seed words, squares written, and runtime, then the totals
+*/
+template<int N>
+void Batch<N>::print_summary() {
+	long total = 0;
+	long busy = 0;
+	cout << endl << "query   line    seeds   squares     ms" << endl;
+	for(unsigned i=0; i<queries.size(); i++) {
+		Query& q = queries[i];
+		char row[128];
+		snprintf(row, sizeof(row), "%-7u %-7d %-7d %-11ld %ld", i+1, q.line, (int)q.seeds.size(), q.found, q.ms);
+		cout << row << endl;
+		total += q.found;
+		busy += q.ms;
+	}
+	cout << endl << "solved " << queries.size() << " queries, " << total << " wordsquares, ";
+	cout << busy << " ms of search in " << wall_ms << " ms" << endl;
+}
+
+// return the number of seed sets read
+template<int N>
+int Batch<N>::get_numqueries() {
+	return queries.size();
+}
+
+// set the wordlist object
+template<int N>
+void Batch<N>::set_dict(Dict *d) {
+	dict = d;
+}
+
+// set the precomputed regs object
+template<int N>
+void Batch<N>::set_regs(Regs *r) {
+	regs = r;
+}
+
+// set the precomputed match matrix
+template<int N>
+void Batch<N>::set_matches(Matches *m) {
+	matches = m;
+}
+
+// set the bitset engine, used in place of regs and matches
+template<int N>
+void Batch<N>::set_bitsets(Bitsets *b) {
+	bitsets = b;
+}
+
+// set the trie engine
+template<int N>
+void Batch<N>::set_trie(Trie *t) {
+	trie = t;
+}
+
+template class Batch<3>;
+template class Batch<4>;
+template class Batch<5>;
+template class Batch<6>;
+template class Batch<7>;
+template class Batch<8>;
@@ -0,0 +1,83 @@
+/*
+	Batch runner header, Batch.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Solves many seed sets in one process over the loaded
+	Dict, Regs, Matches, Bitsets, or Trie, which are only read.
+	The seed sets come from a list file, one set per line.
+	A pool of threads runs the queries at once, each on one thread,
+	and writes each query's squares to its own file,
+	or every square to one output tagged with its query.
+
+	Queries with fewer than BATCH_EASY seed words can take far longer.
+	They are started first, so a long one doesn't finish last,
+	but only on up to half the pool while easy ones are waiting,
+	so the easy ones keep moving.
+
+	Templated on the width of the square, like Squares
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+// queries with at least this many seed words are scheduled as easy
+#define BATCH_EASY 5
+
+/* one seed set of the list, and how its run went */
+struct Query {
+	int line;				// line of the list file
+	vector<string> seeds;
+	bool hard;
+	long found;
+	long ms;
+	int error;				// errno of a failed write of its own output file, 0 if none
+};
+
+template<int N>
+class Batch {
+
+	public:
+		Batch(string, Options&);
+
+		void set_dict(Dict*);
+		void set_regs(Regs*);
+		void set_matches(Matches*);
+		void set_bitsets(Bitsets*);
+		void set_trie(Trie*);
+
+		long run(string, int);
+		void print_summary();
+
+		int get_numqueries();
+
+	private:
+		void read_list();
+		void work();
+		int next_query(bool&);
+		void solve(int);
+
+		string listfile;
+		Options opts;
+		vector<Query> queries;
+
+		Dict *dict;
+		Regs *regs;
+		Matches *matches;
+		Bitsets *bitsets;
+		Trie *trie;
+
+		string outdir;			// one file per query in this directory, if not empty
+		Writer *shared;			// otherwise one tagged output for every query
+
+		deque<int> easy;		// queries waiting to run, in list order
+		deque<int> hard;
+		int running_hard;
+		int max_hard;			// hard queries allowed to run while easy ones wait
+		mutex lock;
+		long wall_ms;
+};
+
+#endif
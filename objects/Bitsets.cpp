@@ -0,0 +1,215 @@
+/*
+	Bitset candidate engine implementation, Bitsets.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Finds the words that fit a regex by intersecting 
+	per-position, per-character bitsets over the wordlist.
+	Intersections are done 256 bits at a time, with AVX2 
+	when the processor supports it and with 4 64-bit ANDs otherwise
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#endif
+
+/*
+	AND together n bitsets over one 256-bit chunk starting at word w, into out.
+	Scalar version, and an AVX2 version compiled for AVX2 
+	regardless of the build flags, only called when the processor supports it
+*/
+static inline void and_chunk(const uint64* const* sets, int n, int w, uint64* out) {
+	out[0] = sets[0][w];
+	out[1] = sets[0][w+1];
+	out[2] = sets[0][w+2];
+	out[3] = sets[0][w+3];
+	for(int k=1; k<n; k++) {
+		out[0] &= sets[k][w];
+		out[1] &= sets[k][w+1];
+		out[2] &= sets[k][w+2];
+		out[3] &= sets[k][w+3];
+	}
+}
+
+#ifdef HAVE_X86
+__attribute__((target("avx2")))
+static void and_chunk_avx2(const uint64* const* sets, int n, int w, uint64* out) {
+	__m256i acc = _mm256_loadu_si256( (const __m256i*)(sets[0]+w) );
+	for(int k=1; k<n; k++) {
+		acc = _mm256_and_si256( acc, _mm256_loadu_si256( (const __m256i*)(sets[k]+w) ) );
+	}
+	_mm256_storeu_si256( (__m256i*)out, acc );
+}
+#endif
+
+/*
+	AND together the summaries of n bitsets over summary word s,
+	giving one bit for every chunk that may hold a match
+*/
+static inline uint64 and_summary(const uint64* const* sums, int n, int s) {
+	uint64 live = sums[0][s];
+	for(int k=1; k<n; k++) {
+		live &= sums[k][s];
+	}
+	return live;
+}
+
+// Default Constructor
+Bitsets::Bitsets() {
+	numwords = 0;
+	wordlen = 0;
+	blocks = 0;
+	use_avx2 = false;
+}
+
+// Initialize the bitsets from a wordlist
+Bitsets::Bitsets(Dict* dict) {
+	build(dict);
+}
+
+/*
+	Set one bit per word in the bitset of each of its characters.
+	Bitsets are padded with zero bits to a whole number of 256-bit chunks
+*/
+void Bitsets::build(Dict* dict) {
+	cout << "building bitset engine" << endl;
+	numwords = dict->get_size();
+	wordlen = dict->get_wordlen();
+	blocks = ((numwords+255)/256)*4;
+	sblocks = (blocks/4+63)/64;
+	bits = vector<uint64>( (long)wordlen*NUMCHARS*blocks, 0 );
+	summary = vector<uint64>( (long)wordlen*NUMCHARS*sblocks, 0 );
+
+	string word;
+	for(int i=0; i<numwords; i++) {
+		word = dict->get_word(i);
+		for(int p=0; p<wordlen; p++) {
+			long set = p*NUMCHARS + key_code(word[p]) - 1;
+			bits[set*blocks + i/64] |= 1ULL << (i%64);
+			summary[set*sblocks + i/256/64] |= 1ULL << ((i/256)%64);
+		}
+	}
+
+#ifdef HAVE_X86
+	use_avx2 = __builtin_cpu_supports("avx2");
+#else
+	use_avx2 = false;
+#endif
+	cout << "built " << wordlen*NUMCHARS << " bitsets of " << numwords << " words";
+	cout << (use_avx2 ? " (avx2)" : " (scalar)") << endl << endl;
+}
+
+/*
+	Collect the bitsets and summaries of the fixed positions of a packed regex key
+	into sets and sums, return how many there are.
+	A regex with no fixed positions returns 0 and is reported as matching nothing,
+	Squares handles that regex itself
+*/
+int Bitsets::gather(uint64 key, const uint64** sets, const uint64** sums) {
+	int n = 0;
+	for(int p=wordlen-1; p>=0; p--) {
+		unsigned code = key & ((1u << KEYBITS)-1);
+		key >>= KEYBITS;
+		if( code != 0 ) {
+			long set = (long)p*NUMCHARS + code - 1;
+			sets[n] = &bits[set*blocks];
+			sums[n] = &summary[set*sblocks];
+			n++;
+		}
+	}
+	return n;
+}
+
+/*
+	Write the indices of all words that fit the regex with the given key 
+	to matches, in increasing order, the same as Matches::get_matches 
+	for the regex's column, and return how many there are.
+	matches must have room for every word, so the search can 
+	hand in a buffer set up once rather than allocate.
+	Only chunks live in every summary are intersected
+*/
+int Bitsets::get_matches(uint64 key, int* matches) {
+	int total = 0;
+	const uint64* sets[MAXLEN];
+	const uint64* sums[MAXLEN];
+	int n = gather(key, sets, sums);
+	if( n == 0 ) return 0;
+
+	uint64 chunk[4];
+	for(int s=0; s<sblocks; s++) {
+		uint64 live = and_summary(sums, n, s);
+		while( live ) {
+			int w = (s*64 + __builtin_ctzll(live))*4;
+			live &= live-1;
+#ifdef HAVE_X86
+			if( use_avx2 ) and_chunk_avx2(sets, n, w, chunk);
+			else and_chunk(sets, n, w, chunk);
+#else
+			and_chunk(sets, n, w, chunk);
+#endif
+			for(int j=0; j<4; j++) {
+				uint64 b = chunk[j];
+				while( b ) {
+					matches[total++] = (w+j)*64 + __builtin_ctzll(b);
+					b &= b-1;
+				}
+			}
+		}
+	}
+	return total;
+}
+
+// return the number of words that fit the regex, without collecting them
+int Bitsets::count(uint64 key) {
+	const uint64* sets[MAXLEN];
+	const uint64* sums[MAXLEN];
+	int n = gather(key, sets, sums);
+	if( n == 0 ) return 0;
+
+	uint64 chunk[4];
+	int total = 0;
+	for(int s=0; s<sblocks; s++) {
+		uint64 live = and_summary(sums, n, s);
+		while( live ) {
+			int w = (s*64 + __builtin_ctzll(live))*4;
+			live &= live-1;
+			and_chunk(sets, n, w, chunk);
+			total += __builtin_popcountll(chunk[0]) + __builtin_popcountll(chunk[1])
+				+ __builtin_popcountll(chunk[2]) + __builtin_popcountll(chunk[3]);
+		}
+	}
+	return total;
+}
+
+/*
+	return true if any word fits the regex.
+	Stops at the first nonzero chunk
+*/
+bool Bitsets::any(uint64 key) {
+	const uint64* sets[MAXLEN];
+	const uint64* sums[MAXLEN];
+	int n = gather(key, sets, sums);
+	if( n == 0 ) return false;
+
+	uint64 chunk[4];
+	for(int s=0; s<sblocks; s++) {
+		uint64 live = and_summary(sums, n, s);
+		while( live ) {
+			int w = (s*64 + __builtin_ctzll(live))*4;
+			live &= live-1;
+			and_chunk(sets, n, w, chunk);
+			if( chunk[0] | chunk[1] | chunk[2] | chunk[3] ) return true;
+		}
+	}
+	return false;
+}
+
+// return the number of words in the bitsets
+int Bitsets::get_numwords() {
+	return numwords;
+}
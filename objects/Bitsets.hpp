@@ -0,0 +1,54 @@
+/*
+	Bitset candidate engine header, Bitsets.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	An alternative to Regs and Matches for finding the words that fit a regex.
+	For every position in a word and every character ('a' through 'z' and '-')
+	there is a bitset over the word indices in the Dict, 
+	with a bit set if the word has that character at that position.
+	The words that fit a regex like "*a**r" are the set bits of the AND 
+	of the bitsets for the fixed positions, here 'a' at 1 and 'r' at 4.
+
+	Each bitset also has a summary with one bit per 256-bit chunk,
+	set if the chunk has any bit set, so chunks that are empty in 
+	any of the intersected bitsets are skipped without being read.
+
+	Needs only the Dict, so index size is linear in the wordlist.
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef BITSETS_HPP
+#define BITSETS_HPP
+
+// characters per position, 'a' through 'z' and '-'
+#define NUMCHARS 27
+
+class Bitsets {
+
+	public:
+		Bitsets();
+		Bitsets(Dict*);
+
+		void build(Dict*);
+
+		int get_matches(uint64, int*);
+		int count(uint64);
+		bool any(uint64);
+
+		int get_numwords();
+
+	private:
+		int gather(uint64, const uint64**, const uint64**);
+
+		vector<uint64> bits;	// wordlen*NUMCHARS bitsets of blocks words each
+		vector<uint64> summary;	// wordlen*NUMCHARS summaries of sblocks words each
+		int numwords;
+		int wordlen;
+		int blocks;				// 64-bit words per bitset, a multiple of 4
+		int sblocks;			// 64-bit words per summary, one bit per 4 blocks
+		bool use_avx2;
+};
+
+#endif
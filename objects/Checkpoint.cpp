@@ -0,0 +1,159 @@
+/*
+	Search checkpoint implementation, Checkpoint.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	The file is one field per line, a keyword and its values:
+
+		wordsquares checkpoint 2
+		seeds 3 word word word
+		seedsquares 31
+		dict 39432
+		settings csc fc 1 dynamic 1 ac 1 dedupe 1 ...
+		output COUNT OFFSET FORMAT FILE
+		search ACCEPTED FINISHED CAPPED NODES ELAPSED SLICE
+		queue K
+		FOUND LENGTH PATH...		K lines, one per seedsquare left
+		seen DUPLICATES M
+		KEY							M lines, see Square::canonical_key
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+// set by the SIGTERM handler, checked by the search
+static atomic<bool> sigterm(false);
+
+/*
+	A checkpoint kept in file, written every given number of seconds
+	and on SIGTERM, which no longer ends the program right away
+*/
+Checkpoint::Checkpoint(string str, long seconds) {
+	file = str;
+	every = seconds;
+	last = chrono::steady_clock::now();
+	resumed = false;
+	numseeds = 0;
+	dictsize = 0;
+	count = 0;
+	offset = 0;
+	numaccepted = 0;
+	numfinished = 0;
+	numcapped = 0;
+	numnodes = 0;
+	elapsed = 0;
+	slice = -1;
+	duplicates = 0;
+	signal(SIGTERM, Checkpoint::on_terminate);
+}
+
+// read the checkpoint in the file to resume from, exit if it can't be read
+void Checkpoint::read() {
+	ifstream in(file.c_str());
+	string word;
+	int version = 0;
+	bool ok = (in >> word) && word == "wordsquares" && (in >> word) && word == "checkpoint" && (in >> version);
+	if( ok && version != CHECKPOINT_VERSION ) {
+		cout << "ERROR: checkpoint " << file << " is version " << version;
+		cout << ", this program reads version " << CHECKPOINT_VERSION << endl;
+		exit(-1);
+	}
+
+	int numwords = 0;
+	ok = ok && (in >> word) && word == "seeds" && (in >> numwords);
+	seedwords.assign(ok ? numwords : 0, "");
+	for(int i=0; ok && i<numwords; i++) ok = (bool)(in >> seedwords[i]);
+	ok = ok && (in >> word) && word == "seedsquares" && (in >> numseeds);
+	ok = ok && (in >> word) && word == "dict" && (in >> dictsize);
+	ok = ok && (in >> word) && word == "settings" && getline(in, settings);
+	ok = ok && (in >> word) && word == "output" && (in >> count >> offset >> format) && getline(in, outfile);
+	ok = ok && (in >> word) && word == "search"
+		&& (in >> numaccepted >> numfinished >> numcapped >> numnodes >> elapsed >> slice);
+
+	int numpending = 0;
+	ok = ok && (in >> word) && word == "queue" && (in >> numpending);
+	queue.assign(ok ? numpending : 0, Pending());
+	for(int i=0; ok && i<numpending; i++) {
+		int len = 0;
+		ok = (in >> queue[i].found >> len) && len > 0;
+		queue[i].path.assign(ok ? len : 0, 0);
+		for(int j=0; ok && j<len; j++) ok = (bool)(in >> queue[i].path[j]);
+	}
+
+	long numseen = 0;
+	ok = ok && (in >> word) && word == "seen" && (in >> duplicates >> numseen);
+	seen.assign(ok ? numseen : 0, "");
+	for(long i=0; ok && i<numseen; i++) ok = (bool)(in >> seen[i]);
+
+	if( !ok ) {
+		cout << "ERROR: cannot read checkpoint " << file << endl;
+		cout << "exiting program" << endl;
+		exit(-1);
+	}
+	settings.erase(0, settings.find_first_not_of(' '));
+	outfile.erase(0, outfile.find_first_not_of(' '));
+	resumed = true;
+}
+
+/*
+	Write the checkpoint to a temporary file and rename it over the file.
+	A checkpoint that can't be written is reported, and the search goes on
+*/
+void Checkpoint::write() {
+	string tmpfile = file + ".tmp";
+	ofstream out(tmpfile.c_str());
+	out << "wordsquares checkpoint " << CHECKPOINT_VERSION << "\n";
+	out << "seeds " << seedwords.size();
+	for(unsigned i=0; i<seedwords.size(); i++) out << " " << seedwords[i];
+	out << "\n";
+	out << "seedsquares " << numseeds << "\n";
+	out << "dict " << dictsize << "\n";
+	out << "settings " << settings << "\n";
+	out << "output " << count << " " << offset << " " << format << " " << outfile << "\n";
+	out << "search " << numaccepted << " " << numfinished << " " << numcapped << " ";
+	out << numnodes << " " << elapsed << " " << slice << "\n";
+	out << "queue " << queue.size() << "\n";
+	for(unsigned i=0; i<queue.size(); i++) {
+		out << queue[i].found << " " << queue[i].path.size();
+		for(unsigned j=0; j<queue[i].path.size(); j++) out << " " << queue[i].path[j];
+		out << "\n";
+	}
+	out << "seen " << duplicates << " " << seen.size() << "\n";
+	for(unsigned i=0; i<seen.size(); i++) out << seen[i] << "\n";
+	out.close();
+
+	if( !out || rename(tmpfile.c_str(), file.c_str()) != 0 ) {
+		cout << "ERROR: cannot write checkpoint " << file << endl;
+	}
+	last = chrono::steady_clock::now();
+}
+
+// delete the checkpoint once the search it belongs to is complete
+void Checkpoint::remove() {
+	unlink(file.c_str());
+}
+
+/*
+	test if a checkpoint should be written,
+	every seconds after the last one, or after SIGTERM
+*/
+bool Checkpoint::due() {
+	if( sigterm ) return true;
+	return every > 0 && chrono::steady_clock::now() - last >= chrono::seconds(every);
+}
+
+// return the path of the checkpoint file
+string Checkpoint::get_file() {
+	return file;
+}
+
+// test if the program got SIGTERM
+bool Checkpoint::terminated() {
+	return sigterm;
+}
+
+// SIGTERM handler, the search writes the checkpoint and stops
+void Checkpoint::on_terminate(int sig) {
+	sigterm = true;
+}
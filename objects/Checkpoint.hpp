@@ -0,0 +1,81 @@
+/*
+	Search checkpoint header, Checkpoint.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Saves how far a single threaded search got, so a run that is stopped
+	can be continued later with --resume, without writing any square twice.
+	A checkpoint holds the seedsquares still to search, each with the
+	search path to continue from, the seedsquare index followed by the
+	slot of the candidate taken at each depth, as in Worker::resume.
+	It also holds the length and square count of the output written so far,
+	the canonical keys of the squares written with --dedupe,
+	and the counters of the limits.
+	The seedwords, wordlist size, and search settings are saved too,
+	so a checkpoint can't be continued by a different search.
+
+	Squares fills in the fields and calls write every few seconds,
+	and when the program gets SIGTERM.  The file is text,
+	written to a temporary file first and renamed over the last checkpoint,
+	so there is always one complete checkpoint on disk.
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#define CHECKPOINT_VERSION 2
+
+/* a seedsquare left to search, and the count of its squares let through the limits */
+struct Pending {
+	vector<int> path;		// search path to continue from, path[0] is the seedsquare
+	long found;
+};
+
+class Checkpoint {
+
+	public:
+		Checkpoint(string, long);
+
+		void read();
+		void write();
+		void remove();
+		bool due();
+		string get_file();
+		static bool terminated();
+
+		bool resumed;				// read from a file, the search continues it
+
+		// what the checkpoint belongs to, checked on resume
+		vector<string> seedwords;
+		int numseeds;				// seedsquares generated from the seedwords
+		long dictsize;
+		string settings;			// engine and search settings, see Squares::get_settings
+
+		// the output written so far
+		string outfile;
+		string format;
+		long count;
+		long offset;				// bytes
+
+		// the search so far
+		long numaccepted;
+		int numfinished;
+		int numcapped;
+		long numnodes;
+		long elapsed;				// ms
+		long slice;					// nodes left in the turn of the first seedsquare, -1 for a new turn
+		vector<Pending> queue;
+		vector<string> seen;		// keys of the squares written, with --dedupe
+		long duplicates;
+
+	private:
+		static void on_terminate(int);
+
+		string file;
+		long every;					// seconds between checkpoints
+		chrono::steady_clock::time_point last;
+};
+
+#endif
@@ -0,0 +1,290 @@
+/*
+	Multi-process search coordinator implementation, Coordinator.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	The coordinator waits on every worker's socket with poll.
+	A worker process runs a plain loop, reading a shard,
+	searching it, and answering with its squares and a done line
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+/*
+	Coordinate numprocs worker processes, each limited to memlimit MB
+	of address space, 0 for no limit.  Ordered merges the squares
+	of the shards in the order they were added
+*/
+Coordinator::Coordinator(int n, long mem, bool o) {
+	numprocs = n;
+	memlimit = mem;
+	ordered = o;
+	nextmerge = 0;
+	numnodes = 0;
+	numfailed = 0;
+	numrestarts = 0;
+}
+
+// add a shard, the candidates lo to hi-1 at the first level of a seedsquare
+void Coordinator::add(int seed, int lo, int hi) {
+	Shard s;
+	s.id = shards.size();
+	s.seed = seed;
+	s.lo = lo;
+	s.hi = hi;
+	s.tries = 0;
+	shards.push_back(s);
+}
+
+/*
+	Search every shard.  search runs in a worker process,
+	it searches a shard and writes its squares to the socket given,
+	as square lines, and returns the number of nodes searched.
+	merge gets the squares of each shard once it's done,
+	or of a shard given up on, which has none.
+	The run ends early once stop returns true, checked every COORD_POLL_MS,
+	then the workers are killed and the squares of the shards
+	they were searching are merged as they are
+*/
+void Coordinator::run(function<long(Shard&, int)> search, function<void(Shard&, vector<string>&)> merge, function<bool()> stop) {
+
+	finished.assign(shards.size(), false);
+	for(unsigned i=0; i<shards.size(); i++) pending.push_back(i);
+	procs.resize( min(numprocs, (int)shards.size()) );
+	for(unsigned i=0; i<procs.size(); i++) {
+		procs[i].pid = -1;
+		procs[i].fd = -1;
+		procs[i].shard = -1;
+	}
+
+	bool stopped = false;
+	while( true ) {
+		if( stop() ) {
+			stopped = true;
+			break;
+		}
+
+		// start workers that are missing, and keep every worker busy
+		bool busy = false;
+		for(unsigned i=0; i<procs.size(); i++) {
+			if( procs[i].pid < 0 && !pending.empty() ) spawn(procs[i], search);
+			if( procs[i].pid > 0 && procs[i].shard < 0 && !pending.empty() ) assign(procs[i]);
+			if( procs[i].shard >= 0 ) busy = true;
+		}
+		if( !busy ) break;
+
+		vector<struct pollfd> p(procs.size());
+		for(unsigned i=0; i<procs.size(); i++) {
+			p[i].fd = procs[i].pid > 0 ? procs[i].fd : -1;
+			p[i].events = POLLIN;
+			p[i].revents = 0;
+		}
+		int numready = poll(p.data(), p.size(), COORD_POLL_MS);
+		if( numready < 0 && errno != EINTR ) {
+			cout << "ERROR: poll failed on the worker processes" << endl;
+			stopped = true;
+			break;
+		}
+		for(unsigned i=0; numready > 0 && i<procs.size(); i++) {
+			if( p[i].revents && !read_lines(procs[i], merge) ) lost(procs[i], merge);
+		}
+	}
+
+	// quit or kill the workers, and keep what the unfinished shards found
+	for(unsigned i=0; i<procs.size(); i++) {
+		Proc& w = procs[i];
+		if( w.pid < 0 ) continue;
+		if( stopped ) kill(w.pid, SIGKILL);
+		else send(w.fd, "quit\n");
+		::close(w.fd);
+		waitpid(w.pid, NULL, 0);
+		w.pid = -1;
+		if( w.shard >= 0 ) held[w.shard].swap(w.squares);
+	}
+	for(auto it = held.begin(); it != held.end(); it++) {
+		merge(shards[it->first], it->second);
+	}
+	held.clear();
+}
+
+/*
+	Fork a worker process connected to this one by a socket.
+	The child closes the other workers' sockets, takes its memory limit,
+	and serves shards until it's told to quit
+*/
+void Coordinator::spawn(Proc& w, function<long(Shard&, int)>& search) {
+	int sv[2];
+	if( socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0 ) {
+		cout << "ERROR: cannot create a socket for a worker process" << endl;
+		exit(-1);
+	}
+	cout.flush();
+	pid_t pid = fork();
+	if( pid < 0 ) {
+		cout << "ERROR: cannot fork a worker process" << endl;
+		exit(-1);
+	}
+	if( pid == 0 ) {
+		::close(sv[0]);
+		for(unsigned i=0; i<procs.size(); i++) {
+			if( procs[i].pid > 0 ) ::close(procs[i].fd);
+		}
+		if( memlimit > 0 ) {
+			struct rlimit limit;
+			limit.rlim_cur = limit.rlim_max = (rlim_t)memlimit << 20;
+			setrlimit(RLIMIT_AS, &limit);
+		}
+		work(sv[1], search);
+		_exit(0);
+	}
+	::close(sv[1]);
+	w.pid = pid;
+	w.fd = sv[0];
+	w.shard = -1;
+	w.inbuf.clear();
+	w.squares.clear();
+}
+
+// worker process loop, search each shard sent and report it done
+void Coordinator::work(int fd, function<long(Shard&, int)>& search) {
+	string inbuf;
+	char buf[256];
+	while( true ) {
+		size_t nl = inbuf.find('\n');
+		if( nl == string::npos ) {
+			ssize_t n = read(fd, buf, sizeof(buf));
+			if( n <= 0 ) return;
+			inbuf.append(buf, n);
+			continue;
+		}
+		string line = inbuf.substr(0, nl);
+		inbuf.erase(0, nl+1);
+		Shard s;
+		if( sscanf(line.c_str(), "shard %d %d %d %d", &s.id, &s.seed, &s.lo, &s.hi) != 4 ) return;
+		long nodes = search(s, fd);
+		send(fd, "done " + to_string(s.id) + " " + to_string(nodes) + "\n");
+	}
+}
+
+// hand the next shard to an idle worker
+void Coordinator::assign(Proc& w) {
+	Shard& s = shards[ pending.front() ];
+	pending.pop_front();
+	w.shard = s.id;
+	w.squares.clear();
+	send(w.fd, "shard " + to_string(s.id) + " " + to_string(s.seed) + " "
+		+ to_string(s.lo) + " " + to_string(s.hi) + "\n");
+}
+
+/*
+	A shard is done, merge its squares, or when ordered,
+	hold them until every earlier shard is merged
+*/
+void Coordinator::finish(int id, vector<string>& squares, function<void(Shard&, vector<string>&)>& merge) {
+	finished[id] = true;
+	if( !ordered ) {
+		merge(shards[id], squares);
+		return;
+	}
+	held[id].swap(squares);
+	while( nextmerge < (int)shards.size() && finished[nextmerge] ) {
+		merge(shards[nextmerge], held[nextmerge]);
+		held.erase(nextmerge);
+		nextmerge++;
+	}
+}
+
+/*
+	Read what a worker has sent and act on each whole line.
+	Return false if the worker is gone
+*/
+bool Coordinator::read_lines(Proc& w, function<void(Shard&, vector<string>&)>& merge) {
+	char buf[1 << 16];
+	ssize_t n = read(w.fd, buf, sizeof(buf));
+	if( n <= 0 ) return false;
+	w.inbuf.append(buf, n);
+
+	size_t pos = 0, nl;
+	while( (nl = w.inbuf.find('\n', pos)) != string::npos ) {
+		if( w.inbuf.compare(pos, 7, "square ") == 0 ) {
+			w.squares.push_back( w.inbuf.substr(pos+7, nl-pos-7) );
+		} else if( w.inbuf.compare(pos, 5, "done ") == 0 ) {
+			numnodes += atol( w.inbuf.c_str() + w.inbuf.find(' ', pos+5) );
+			int id = w.shard;
+			w.shard = -1;
+			finish(id, w.squares, merge);
+			w.squares.clear();
+		}
+		pos = nl+1;
+	}
+	w.inbuf.erase(0, pos);
+	return true;
+}
+
+/*
+	A worker died.  Drop what it found of its shard and queue the shard
+	to be searched again, or give it up after SHARD_TRIES tries.
+	A new worker is started when there's a shard for it
+*/
+void Coordinator::lost(Proc& w, function<void(Shard&, vector<string>&)>& merge) {
+	int status = 0;
+	::close(w.fd);
+	waitpid(w.pid, &status, 0);
+	cout << "worker process " << w.pid;
+	if( WIFSIGNALED(status) ) cout << " killed by signal " << WTERMSIG(status);
+	else cout << " exited with status " << WEXITSTATUS(status);
+	w.pid = -1;
+	w.fd = -1;
+	w.inbuf.clear();
+	w.squares.clear();
+	numrestarts++;
+
+	if( w.shard < 0 ) {
+		cout << endl;
+		return;
+	}
+	Shard& s = shards[w.shard];
+	w.shard = -1;
+	s.tries++;
+	if( s.tries < SHARD_TRIES ) {
+		cout << ", searching shard " << s.id << " again" << endl;
+		pending.push_front(s.id);
+	} else {
+		cout << ", giving up on shard " << s.id << " of seedsquare " << s.seed << endl;
+		numfailed++;
+		vector<string> none;
+		finish(s.id, none, merge);
+	}
+}
+
+// write a whole line to a socket, a worker that's gone is found by poll
+void Coordinator::send(int fd, string line) {
+	size_t done = 0;
+	while( done < line.size() ) {
+		ssize_t n = ::send(fd, line.data()+done, line.size()-done, MSG_NOSIGNAL);
+		if( n <= 0 ) return;
+		done += n;
+	}
+}
+
+// return the number of shards
+int Coordinator::get_numshards() {
+	return shards.size();
+}
+
+// return the search nodes visited by all workers, over the shards they finished
+long Coordinator::get_numnodes() {
+	return numnodes;
+}
+
+// return the number of shards given up on
+int Coordinator::get_numfailed() {
+	return numfailed;
+}
+
+// return the number of workers that died and were replaced
+int Coordinator::get_numrestarts() {
+	return numrestarts;
+}
@@ -0,0 +1,102 @@
+/*
+	Multi-process search coordinator header, Coordinator.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Splits one search across worker processes on the same machine.
+	The work is cut into shards, a seedsquare and a range of the
+	candidates for the first word placed in it, the first level of
+	the search.  Worker processes are forked after the tables are loaded,
+	so a binary index mapped from its file is shared by all of them,
+	and parsed tables are shared until written, which they never are.
+
+	The coordinator hands out one shard at a time to each worker,
+	and another as soon as it's done, so the cheap shards don't wait
+	on the expensive ones.  Workers send back the squares of a shard,
+	which are held until the shard is done and then merged.
+	A worker that dies, killed, out of memory under its limit,
+	or crashed, takes nothing with it: its shard's squares are dropped,
+	a new worker is started, and the shard is searched again,
+	up to SHARD_TRIES times.
+
+	Workers talk to the coordinator over a socket, a line at a time:
+		shard ID SEED LO HI		coordinator to worker, search a shard
+		quit					coordinator to worker
+		square GRID				worker to coordinator, a square of the shard
+		done ID NODES			worker to coordinator, the shard is finished
+	GRID is the rows of the square run together.  Nothing depends on
+	the worker sharing a machine but the fork, so workers elsewhere
+	could be fed the same lines.
+
+	Not templated, the search of a shard and the merge of its squares
+	are functions given by Squares
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef COORDINATOR_HPP
+#define COORDINATOR_HPP
+
+// times a shard is tried before it's given up
+#define SHARD_TRIES 2
+
+// ms between checks of the stop function while waiting on workers
+#define COORD_POLL_MS 10
+
+/* a piece of the search, the candidates lo to hi-1 at the first level of a seedsquare */
+struct Shard {
+	int id;
+	int seed;
+	int lo;
+	int hi;
+	int tries;
+};
+
+class Coordinator {
+
+	public:
+		Coordinator(int, long, bool);
+
+		void add(int, int, int);
+		void run(function<long(Shard&, int)>, function<void(Shard&, vector<string>&)>, function<bool()>);
+
+		int get_numshards();
+		long get_numnodes();
+		int get_numfailed();
+		int get_numrestarts();
+
+	private:
+		// a running worker process and the shard it's searching
+		struct Proc {
+			pid_t pid;
+			int fd;
+			int shard;					// -1 when idle
+			string inbuf;
+			vector<string> squares;		// of the current shard
+		};
+
+		void spawn(Proc&, function<long(Shard&, int)>&);
+		void work(int, function<long(Shard&, int)>&);
+		void assign(Proc&);
+		void finish(int, vector<string>&, function<void(Shard&, vector<string>&)>&);
+		bool read_lines(Proc&, function<void(Shard&, vector<string>&)>&);
+		void lost(Proc&, function<void(Shard&, vector<string>&)>&);
+		void send(int, string);
+
+		int numprocs;
+		long memlimit;				// MB of address space per worker, 0 for no limit
+		bool ordered;				// merge shards in order, as one process would find their squares
+
+		vector<Shard> shards;
+		deque<int> pending;			// shards not handed out yet
+		vector<Proc> procs;
+		map<int, vector<string> > held;	// finished shards waiting for earlier ones, when ordered
+		vector<bool> finished;
+		int nextmerge;				// first shard not merged yet, when ordered
+
+		long numnodes;
+		int numfailed;
+		int numrestarts;
+};
+
+#endif
@@ -2,7 +2,7 @@
 	Dictionary object implementation, Dict.cpp
 	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
 
-	Stores words from a wordlist in a vector
+	Stores words from a wordlist in a fixed-width table
 	
 	This software is distributed under 
 	the modified Berkeley Software Distribution (BSD) License.
@@ -11,19 +11,38 @@
 #include "wslib.hpp"
 
 /* Default Constructor */
-Dict::Dict(){}
+Dict::Dict() {
+	weights = NULL;
+	maxweight = 0;
+}
 
 /* Initialize object with the wordlist filename */
 Dict::Dict(string str) {
+	weights = NULL;
+	maxweight = 0;
 	dictfile = str;
 	read_dictfile(dictfile);
 
 }
 
+/* Initialize object with the word table of a mapped index */
+Dict::Dict(Index* index) {
+	words = index->get_words();
+	size = index->get_numwords();
+	wordlen = index->get_wordlen();
+	all = vector<int>(size);
+	for(int i=0; i<size; i++) all[i] = i;
+	weights = index->get_weights();
+	find_maxweight();
+}
+
 /*
-	Read in a given wordlist and store it in a vector.
+	Read in a given wordlist and store it in a fixed-width table.
 	first line of the wordlist lists the number of entries,
-	followed by one word per line
+	followed by one word per line.
+	Every word has the length of the first one.
+	Words may be followed by a space and their weight, 
+	written by preprocessing with -w, then every one is
 */
 void Dict::read_dictfile(string str) {
 	cout << "loading dictionary: " << str << endl;
@@ -36,10 +55,29 @@ void Dict::read_dictfile(string str) {
 	cout << "loading " << size << " words" << endl;
 
 	string line;
+	wordlen = 0;
 	for(int i=0; i<size; i++) {
 		getline( instream, line );
-		dict.push_back(line);
+		if( i == 0 ) {
+			size_t space = line.find(' ');
+			wordlen = space == string::npos ? line.size() : space;
+			if( space != string::npos ) weights_buf = vector<int>(size);
+			if( wordlen < MINLEN || wordlen > MAXLEN ) {
+				cout << "ERROR: word length " << wordlen << " of " << str << " not between ";
+				cout << MINLEN << " and " << MAXLEN << endl;
+				cout << "exiting program" << endl;
+				exit(-1);
+			}
+			buffer = vector<char>( (long)size*wordlen );
+		}
+		line.copy( &buffer[(long)i*wordlen], wordlen );
+		if( !weights_buf.empty() ) weights_buf[i] = atoi( line.c_str() + min(line.size(), (size_t)wordlen) );
 	}
+	words = buffer.data();
+	if( !weights_buf.empty() ) weights = weights_buf.data();
+	find_maxweight();
+	all = vector<int>(size);
+	for(int i=0; i<size; i++) all[i] = i;
 	instream.close();
 	cout << "dictionary loaded" << endl << endl;
 }
@@ -50,10 +88,59 @@ void Dict::read_dictfile(string str) {
 	that matches a given regex		
 */
 string Dict::get_word(int index) {
-	return dict[index];
+	return string( words + (long)index*wordlen, wordlen );
+}
+
+/*
+	return a pointer to the wordlen characters of the word at a given index,
+	without copying them.  Not null terminated
+*/
+const char* Dict::get_chars(int index) {
+	return words + (long)index*wordlen;
+}
+
+/*
+	return the index of every word, 0 to size-1, 
+	the candidates of a regex of all wildcards
+*/
+const int* Dict::get_all() {
+	return all.data();
+}
+
+// test if the words have weights
+bool Dict::has_weights() {
+	return weights != NULL;
+}
+
+// return the weight of every word, NULL if there are none
+const int* Dict::get_weights() {
+	return weights;
+}
+
+// return the weight of a word, 0 without weights
+int Dict::get_weight(int index) {
+	return weights == NULL ? 0 : weights[index];
+}
+
+// return the largest weight of any word
+int Dict::get_maxweight() {
+	return maxweight;
+}
+
+// find the largest weight, 0 without weights
+void Dict::find_maxweight() {
+	maxweight = 0;
+	for(int i=0; weights != NULL && i<size; i++) {
+		if( i == 0 || weights[i] > maxweight ) maxweight = weights[i];
+	}
 }
 
 /* return number of words in wordlist */
 int Dict::get_size() {
 	return size;
 }
+
+/* return the length of every word, the width of the squares */
+int Dict::get_wordlen() {
+	return wordlen;
+}
@@ -2,8 +2,10 @@
 	Dictionary object header, Dict.hpp
 	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
 
-	Reads in a wordlist and stores the words in a vector.
-	Used in wordsquare generation when looking up words by their index in the matches matrix
+	Reads in a wordlist and stores the words in a fixed-width table,
+	or uses the table of a memory mapped binary index in place.
+	Used in wordsquare generation when looking up words by their index in the matches matrix.
+	Words may have weights from preprocessing, scores used by the --top search
 
 	Dictionary may be a little misleading, wordlist would be more accurate, 
 	but follows the convention laid out on Linux
@@ -21,13 +23,29 @@ class Dict {
 	public:
 		Dict();
 		Dict(string);
+		Dict(Index*);
 		void read_dictfile(string);
 		string get_word(int);
+		const char* get_chars(int);
+		const int* get_all();
+		bool has_weights();
+		const int* get_weights();
+		int get_weight(int);
+		int get_maxweight();
 		int get_size();
+		int get_wordlen();
 	
 	private:
-		vector<string> dict;
+		void find_maxweight();
+
+		vector<char> buffer;	// owns the word table when read from a text file
+		const char* words;		// size*wordlen characters, no terminators
+		vector<int> all;		// every word index in order
+		vector<int> weights_buf;	// owns the weights when read from a text file
+		const int* weights;		// size weights, NULL if there are none
+		int maxweight;			// largest weight
 		int size;
+		int wordlen;
 		string dictfile;
 };
 
@@ -0,0 +1,152 @@
+/*
+	Binary index object implementation, Index.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Maps the binary index file into memory and validates its header.
+	No data is copied, all tables are returned as pointers into the mapping.
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+// Default Constructor
+Index::Index() {
+	data = NULL;
+	length = 0;
+	header = NULL;
+}
+
+// Initialize an Index object with its filename
+Index::Index(string str) {
+	data = NULL;
+	length = 0;
+	header = NULL;
+	indexfile = str;
+	map_indexfile(indexfile);
+}
+
+// unmap the index file
+Index::~Index() {
+	if( data != NULL ) {
+		munmap( (void*)data, length );
+	}
+}
+
+/*
+	Map the index file read-only and check that it is a complete,
+	uncorrupted index of a version this program understands.
+	The checksum pass touches every page once, which also warms the page cache
+*/
+void Index::map_indexfile(string str) {
+	cout << "mapping index file: " << str << endl;
+
+	int fd = open( str.c_str(), O_RDONLY );
+	if( fd < 0 ) fail("cannot open index file " + str);
+
+	struct stat st;
+	if( fstat(fd, &st) != 0 ) fail("cannot stat index file " + str);
+	length = st.st_size;
+	if( length < sizeof(IndexHeader) ) fail("index file " + str + " is too small");
+
+	void* addr = mmap( NULL, length, PROT_READ, MAP_SHARED, fd, 0 );
+	close(fd);
+	if( addr == MAP_FAILED ) fail("cannot map index file " + str);
+	data = (const char*)addr;
+	header = (const IndexHeader*)data;
+
+	if( strncmp(header->magic, WSINDEX_MAGIC, sizeof(header->magic)) != 0 ) {
+		fail(str + " is not a wordsquare index file");
+	}
+	if( header->version != WSINDEX_VERSION ) {
+		fail("index version mismatch, rerun preprocessing");
+	}
+	if( header->wordlen < MINLEN || header->wordlen > MAXLEN ) {
+		fail("index word length is not supported");
+	}
+	if( header->filesize != length ) fail("index file is truncated");
+	if( index_checksum(data + sizeof(IndexHeader), length - sizeof(IndexHeader)) != header->checksum ) {
+		fail("index checksum mismatch, rerun preprocessing");
+	}
+
+	// the checksum doesn't cover the header, so its counts and offsets are checked here
+	bool sections = in_file(header->words_off, header->numwords, header->wordlen)
+		&& in_file(header->regs_off, header->numregs, header->wordlen)
+		&& in_file(header->csc1_off, (uint64_t)header->numregs + 1, sizeof(int))
+		&& in_file(header->csc2_off, header->nnz, sizeof(int))
+		&& (header->weights_off == 0 || in_file(header->weights_off, header->numwords, sizeof(int)));
+	if( !sections || (uint64_t)get_csc1()[header->numregs] != header->nnz ) {
+		fail("index header is corrupted, rerun preprocessing");
+	}
+
+	cout << "mapped " << header->numwords << " words, " << header->numregs << " regs, ";
+	cout << header->nnz << " matches";
+	if( header->weights_off != 0 ) cout << ", with word weights";
+	cout << endl << endl;
+}
+
+/*
+	test if a section of count entries of size bytes at offset
+	lies after the header and within the file, 8 byte aligned
+*/
+bool Index::in_file(uint64_t offset, uint64_t count, uint64_t size) {
+	if( offset < sizeof(IndexHeader) || offset > length || offset % 8 != 0 ) return false;
+	return count <= (length - offset) / size;
+}
+
+// test if a file starts with the index magic string
+bool Index::is_index_file(string str) {
+	char magic[8] = {0};
+	ifstream instream;
+	instream.open( str.c_str(), ios::binary );
+	instream.read( magic, sizeof(magic) );
+	return strncmp( magic, WSINDEX_MAGIC, sizeof(magic) ) == 0;
+}
+
+// print an error message and exit
+void Index::fail(string msg) {
+	cout << "ERROR: " << msg << endl;
+	cout << "exiting program" << endl;
+	exit(-1);
+}
+
+// get methods for the header fields
+int Index::get_wordlen() {
+	return header->wordlen;
+}
+
+int Index::get_numwords() {
+	return header->numwords;
+}
+
+int Index::get_numregs() {
+	return header->numregs;
+}
+
+unsigned long Index::get_nnz() {
+	return header->nnz;
+}
+
+// get methods for the mapped tables
+const char* Index::get_words() {
+	return data + header->words_off;
+}
+
+const char* Index::get_regs() {
+	return data + header->regs_off;
+}
+
+const int* Index::get_csc1() {
+	return (const int*)(data + header->csc1_off);
+}
+
+const int* Index::get_csc2() {
+	return (const int*)(data + header->csc2_off);
+}
+
+// the word weights, NULL if the index has none
+const int* Index::get_weights() {
+	if( header->weights_off == 0 ) return NULL;
+	return (const int*)(data + header->weights_off);
+}
@@ -0,0 +1,48 @@
+/*
+	Binary index object header, Index.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Memory maps the binary index written by preprocessing.
+	The mapping is read-only and shared, so several wordsquare processes
+	on one machine use the same physical pages.
+	Dict, Regs, and Matches are attached to the mapped tables and use them in place.
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef INDEX_HPP
+#define INDEX_HPP
+
+class Index {
+
+	public:
+		Index();
+		Index(string);
+		~Index();
+
+		void map_indexfile(string);
+		static bool is_index_file(string);
+
+		int get_wordlen();
+		int get_numwords();
+		int get_numregs();
+		unsigned long get_nnz();
+
+		const char* get_words();
+		const char* get_regs();
+		const int* get_csc1();
+		const int* get_csc2();
+		const int* get_weights();
+
+	private:
+		bool in_file(uint64_t, uint64_t, uint64_t);
+		void fail(string);
+
+		const char* data;
+		size_t length;
+		const IndexHeader* header;
+		string indexfile;
+};
+
+#endif
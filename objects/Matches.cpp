@@ -20,6 +20,12 @@ Matches::Matches(string str) {
 	read_matches();
 }
 
+// Initialize a Matches object with the csc arrays of a mapped index
+Matches::Matches(Index* index) {
+	csc1 = index->get_csc1();
+	csc2 = index->get_csc2();
+}
+
 /* 
 	Default Destructor
 	Make sure to deallocate array
@@ -51,24 +57,26 @@ void Matches::read_matches() {
 	string line;
 	getline(instream, line);
 	int size1 = atoi( line.c_str() );
-	csc1=vector<int>(size1);
+	csc1_buf=vector<int>(size1);
 	
 	int val;
 	for(int i=0; i<size1; i++) {
 		getline(instream, line);
 		val=atoi(line.c_str() );
-		csc1[i]=val;
+		csc1_buf[i]=val;
 	}
 	
 	getline(instream, line);
 	int size2=atoi(line.c_str());
-	csc2=vector<int>(size2);
+	csc2_buf=vector<int>(size2);
 	
 	for(int i=0; i<size2; i++) {
 		getline( instream, line);
 		val=atoi(line.c_str());
-		csc2[i]=val;
+		csc2_buf[i]=val;
 	}
+	csc1 = csc1_buf.data();
+	csc2 = csc2_buf.data();
 	
 	cout << "matches loaded" << endl << endl;
 
@@ -76,14 +84,12 @@ void Matches::read_matches() {
 }
 
 /*
-	Find the rows of all words that matches a regular expression at index regindex,
-	and return them in a vector.
-	Iterate through the column regindex and put all rows with 1 entries into a vector.
-	This will eventually lead to a vector of words that match the regex
+	Find the rows of all words that matches a regular expression at index regindex.
+	The rows with 1 entries in column regindex are stored together in csc2,
+	return them in place, without copying, for the life of the matrix
 */
-vector<int> Matches::get_matches(int regindex) {
+Span Matches::get_matches(int regindex) {
 
-	vector<int> colmatches;
 	/*unsigned long index, rem;
 	Bits bit;
 	for(unsigned long i=0; i<(unsigned long)numwords; i++) {
@@ -102,16 +108,44 @@ vector<int> Matches::get_matches(int regindex) {
 	}*/
 	int start = csc1[regindex];
 	int end = csc1[regindex+1];
-	int num_matches=end-start;
-	for(int i=0; i<num_matches; i++) {
-		colmatches.push_back(csc2[start+i]);
-	}
+	Span colmatches;
+	colmatches.data = csc2 + start;
+	colmatches.length = end - start;
 		
 	return colmatches;
 	
 
 }
 
+/*
+	Return the number of words that match the regex at index regindex,
+	the length of its column, without reading the column
+*/
+int Matches::count(int regindex) {
+	return csc1[regindex+1] - csc1[regindex];
+}
+
+/*
+	Find the largest weight of the words in every column, 
+	the most a word of that regex can add to a square's score.
+	One pass over csc2, done once after loading
+*/
+void Matches::set_weights(const int* weights) {
+	colmax = vector<int>(numregs);
+	for(int r=0; r<numregs; r++) {
+		int best = weights[ csc2[csc1[r]] ];
+		for(int i=csc1[r]+1; i<csc1[r+1]; i++) {
+			if( weights[csc2[i]] > best ) best = weights[csc2[i]];
+		}
+		colmax[r] = best;
+	}
+}
+
+// return the largest weight of the words matching the regex at index regindex
+int Matches::get_maxweight(int regindex) {
+	return colmax[regindex];
+}
+
 // get numwords method
 unsigned long Matches::get_numwords() {
 	return  numwords;
@@ -11,11 +11,26 @@
 #ifndef MATCHES_HPP
 #define MATCHES_HPP
 
+/*
+	A run of word indices owned by something else, a column of the
+	matches matrix, the word table, or a search buffer.
+	Nothing is copied, it's valid as long as what it points into
+*/
+struct Span {
+	const int* data;
+	unsigned length;
+
+	unsigned size() const { return length; }
+	bool empty() const { return length == 0; }
+	int operator[](unsigned i) const { return data[i]; }
+};
+
 class Matches{
 
 	public:
 		Matches();
 		Matches(string);
+		Matches(Index*);
 		~Matches();
 
 		void read_matches();
@@ -26,15 +41,22 @@ class Matches{
 		unsigned long get_numregs();
 		void set_numregs(unsigned long);
 
-		vector<int> get_matches(int);
+		Span get_matches(int);
+		int count(int);
+
+		void set_weights(const int*);
+		int get_maxweight(int);
 
 	private:
 		
 		//Bits* bits;
 		//int* csr1;
 		//int* csr2;
-		vector<int> csc1;
-		vector<int> csc2;		
+		vector<int> csc1_buf;	// own the csc arrays when read from a text file
+		vector<int> csc2_buf;
+		const int* csc1;
+		const int* csc2;
+		vector<int> colmax;		// largest word weight of each column, with weights
 		//unsigned long size;
 		string matchfile;
 		int numwords;
@@ -0,0 +1,73 @@
+/*
+	Nogood table implementation, Nogoods.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+/*
+	A table taking at most megabytes of memory,
+	the largest power of 2 buckets that fits, at least one.
+	The slots are anonymous mapped memory, which starts out zero,
+	so the pages of a large table are only taken as they are used
+*/
+Nogoods::Nogoods(long megabytes) {
+	uint64 bytes = (uint64)megabytes << 20;
+	uint64 buckets = 1;
+	while( buckets*2 * NOGOOD_WAYS * sizeof(Slot) <= bytes ) buckets *= 2;
+	mask = buckets-1;
+	length = buckets * NOGOOD_WAYS * sizeof(Slot);
+	void* addr = mmap( NULL, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0 );
+	if( addr == MAP_FAILED ) {
+		cout << "ERROR: cannot allocate a nogood table of " << megabytes << " MB" << endl;
+		cout << "exiting program" << endl;
+		exit(-1);
+	}
+	slots = (Slot*)addr;
+}
+
+Nogoods::~Nogoods() {
+	munmap(slots, length);
+}
+
+/*
+	Remember a partial square with no completion, its key and check.
+	Take an empty slot of its bucket, or overwrite one picked by the hash
+	if the bucket is full.  The check is stored before the key,
+	so a reader never pairs the new key with an old check.  
+	Return true if an entry was overwritten
+*/
+bool Nogoods::insert(uint64 key, uint64 check) {
+	Slot* bucket = slots + (key & mask) * NOGOOD_WAYS;
+	for(int i=0; i<NOGOOD_WAYS; i++) {
+		uint64 old = bucket[i].key.load(memory_order_relaxed);
+		if( old == key && bucket[i].check.load(memory_order_relaxed) == check ) return false;
+		if( old == 0 ) {
+			bucket[i].check.store(check, memory_order_relaxed);
+			bucket[i].key.store(key, memory_order_release);
+			return false;
+		}
+	}
+	Slot* slot = &bucket[ (key >> 60) % NOGOOD_WAYS ];
+	slot->key.store(0, memory_order_relaxed);
+	slot->check.store(check, memory_order_release);
+	slot->key.store(key, memory_order_release);
+	return true;
+}
+
+// return the number of slots
+long Nogoods::get_numslots() {
+	return (mask+1) * NOGOOD_WAYS;
+}
+
+// return the number of slots in use, counted by a pass over the table
+long Nogoods::get_used() {
+	long used = 0;
+	for(long i=0; i<get_numslots(); i++) {
+		if( slots[i].key.load(memory_order_relaxed) != 0 ) used++;
+	}
+	return used;
+}
@@ -0,0 +1,76 @@
+/*
+	Nogood table header, Nogoods.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Remembers partial squares whose search found no complete square,
+	so the same dead subtree isn't searched again.  Within a seedsquare
+	each partial square is reached once, a hit comes from seedsquares
+	that overlap, reaching the same partial square from different seeds.
+	Which squares complete a partial square depends only on its grid
+	and which word positions are assigned, the letter domains only prune
+	what can't complete, so a partial square is kept as a hash of the two,
+	see Square::partial_hash.  A hit prunes squares from the output if
+	it's wrong, so each slot keeps a second, independent 64-bit hash as
+	a check, and a hit needs both to match.  The key picks the bucket,
+	so a false hit takes a collision of 64 bits of each hash.
+
+	The table is a fixed array of slots, a key and its check, in buckets
+	of NOGOOD_WAYS slots, sized once from a memory budget.
+	It's shared by every search thread without locks: a slot's words are
+	read and written with atomic loads and stores, and a full bucket
+	overwrites one of its slots, so the table forgets old entries
+	rather than grow.  Two threads storing at once may lose one entry,
+	which only costs a search.  A reader that sees half of a slot being
+	overwritten gets a key and check of different squares, a miss.
+	A key of 0 marks an empty slot.
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef NOGOODS_HPP
+#define NOGOODS_HPP
+
+// slots per bucket, a bucket is a cache line
+#define NOGOOD_WAYS 4
+
+/* lookups, hits, and stores counted by one search thread, summed when it's done */
+struct NogoodCounts {
+	long probes = 0;
+	long hits = 0;
+	long stores = 0;
+	long evictions = 0;
+};
+
+class Nogoods {
+
+	public:
+		Nogoods(long);
+		~Nogoods();
+
+		// test if a partial square, its key and check, is known to have no completion
+		inline bool contains(uint64 key, uint64 check) {
+			Slot* bucket = slots + (key & mask) * NOGOOD_WAYS;
+			for(int i=0; i<NOGOOD_WAYS; i++) {
+				if( bucket[i].key.load(memory_order_acquire) == key
+					&& bucket[i].check.load(memory_order_relaxed) == check ) return true;
+			}
+			return false;
+		}
+
+		bool insert(uint64, uint64);
+		long get_numslots();
+		long get_used();
+
+	private:
+		struct Slot {
+			atomic<uint64> key;
+			atomic<uint64> check;
+		};
+
+		Slot* slots;
+		uint64 mask;				// buckets - 1, the number of buckets is a power of 2
+		size_t length;				// bytes mapped
+};
+
+#endif
@@ -0,0 +1,34 @@
+/*
+	Search options header, Options.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	The settings given on the command line, shared by a single run,
+	the server, and batch runs, and applied to Squares with set_options
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+struct Options {
+	string engine;			// csc, bitset, or trie
+	int numthreads;			// search threads per run
+	bool ordered;			// merge found squares in single threaded order
+	bool forward_check;		// prune with letter domains
+	bool dynamic_order;		// fill the most constrained word first
+	bool root_ac;			// make seedsquares arc consistent first
+	string format;			// text or ndjson
+	bool dedupe;			// drop squares equal to an earlier one or its transpose
+	long max_solutions;		// stop after writing this many squares, 0 for no limit
+	long deadline;			// stop this many ms after the search starts, 0 for none
+	long max_per_seed;		// write at most this many squares per seedsquare, 0 for no limit
+	int numprocs;			// worker processes of a sharded search, 1 for none
+	long worker_mem;		// MB of address space per worker process, 0 for no limit
+	long nogood_mb;			// MB for the table of dead partial squares, 0 for none
+	long top;				// keep the best this many squares by word weight, 0 for every square
+	bool seed_tree;			// place only the first seedword in the seedsquares, the search places the rest
+};
+
+#endif
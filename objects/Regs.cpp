@@ -4,8 +4,9 @@
 
 	Like a wordlist except the words are regular expressions
 	with asterisks as a wildcard for a single letter
-	Stores the list of regexs, as well as a map that maps
-	a given regex to its index in the list
+	Stores the sorted list of regexs in a fixed-width table,
+	and finds the index of a given regex from its packed key
+	with a bitmap and rank lookup
 
 	This object is created from a file that stores
 	all possible regexes that represent words in the wordlist.
@@ -27,10 +28,20 @@ Regs::Regs(string str) {
 
 }
 
+// Initialize a Regs object with the regex table of a mapped index
+Regs::Regs(Index* index) {
+	regs = index->get_regs();
+	size = index->get_numregs();
+	wordlen = index->get_wordlen();
+	build_lookup();
+}
+
 /*
 	Read in the preprocessed Regs file
 	and create the list of regexes.
-	Also create a map of regexes to their index
+	Preprocessing writes the regexes in sorted order,
+	which the rank lookup in get_index relies on.
+	Every regex has the length of the first one
 */
 void Regs::read_regsfile(string str) {
 	cout << "loading regsfile: " << str << endl;
@@ -43,32 +54,118 @@ void Regs::read_regsfile(string str) {
 	cout << "loading " << size << " regs" << endl;
 
 	string line;
+	wordlen = 0;
 	for(int i=0; i<size; i++) {
 		getline( instream, line );
-		regs.push_back(line);
+		if( i == 0 ) {
+			wordlen = line.size();
+			buffer = vector<char>( (long)size*wordlen );
+		}
+		line.copy( &buffer[(long)i*wordlen], wordlen );
 	}
+	regs = buffer.data();
 	instream.close();
 	cout << "regular expressions loaded" << endl;
-	cout << "creating reg-to-index lookup map" << endl;
-	string reg;
+	build_lookup();
+}
+
+/*
+	Create the key lookup structures.
+	Check the keys are strictly increasing through the list, 
+	otherwise a key's rank would not be its index.
+	Then with short keys set the bit of every regex key in the present bitmap,
+	and record for each 64-bit word of the bitmap 
+	how many bits are set in the words before it.
+	With long keys build the hash table instead
+*/
+void Regs::build_lookup() {
+	uint64 key, prev = 0;
+	for(int i=0; i<size; i++) {
+		key = pattern_key( regs + (long)i*wordlen, wordlen );
+		if( i>0 && key <= prev ) {
+			cout << "ERROR: regs are not sorted, rerun preprocessing" << endl;
+			cout << "exiting program" << endl;
+			exit(-1);
+		}
+		prev = key;
+	}
+
+	use_bitmap = KEYBITS*wordlen <= BITMAPBITS;
+	if( !use_bitmap ) {
+		build_table();
+		return;
+	}
+
+	cout << "creating reg-to-index lookup bitmap" << endl;
+	uint64 numkeys = 1ULL << (KEYBITS*wordlen);
+	present = vector<uint64>( (numkeys+63)/64, 0 );
+	rank = vector<int>( (numkeys+63)/64, 0 );
+	for(int i=0; i<size; i++) {
+		key = pattern_key( regs + (long)i*wordlen, wordlen );
+		present[key/64] |= 1ULL << (key%64);
+	}
+
+	int count = 0;
+	for(unsigned w=0; w<present.size(); w++) {
+		rank[w] = count;
+		count += __builtin_popcountll( present[w] );
+	}
+	cout << "reg-to-index bitmap created with " << count << " keys" << endl;
+}
+
+// slot of a key in the hash table, multiplicative hashing
+static inline uint64 table_slot(uint64 key, uint64 mask) {
+	return (key * 0x9E3779B97F4A7C15ULL >> 20) & mask;
+}
+
+/*
+	Create the key to index hash table, with linear probing,
+	sized to a power of 2 at least twice the number of regexes
+*/
+void Regs::build_table() {
+	cout << "creating reg-to-index lookup table" << endl;
+	uint64 tablesize = 1;
+	while( tablesize < 2*(uint64)size ) tablesize <<= 1;
+	table_mask = tablesize-1;
+	table_keys = vector<uint64>( tablesize, ~0ULL );
+	table_index = vector<int>( tablesize, -1 );
+
 	for(int i=0; i<size; i++) {
-		reg=regs[i];
-		reg2index.insert( make_pair(reg,i) );
+		uint64 key = pattern_key( regs + (long)i*wordlen, wordlen );
+		uint64 slot = table_slot(key, table_mask);
+		while( table_keys[slot] != ~0ULL ) slot = (slot+1) & table_mask;
+		table_keys[slot] = key;
+		table_index[slot] = i;
 	}
-	cout << "reg-to-index map created of size: " << reg2index.size() << endl;
+	cout << "reg-to-index table created with " << size << " keys" << endl;
 }
 
 /*
-	Given a regex, return its index in the regex list
-	Use the map reg2index
+	Given a regex, return its index in the regex list,
+	or -1 if no word matches it
 */
-int Regs::get_index(string reg) {
+int Regs::get_index(const string& reg) {
+	return get_index( pattern_key(reg.data(), wordlen) );
+}
 
-	if( reg2index.find(reg) != reg2index.end() ) {
-		return reg2index[reg];
-	} else {
-		return -1;
+/*
+	Given a packed regex key, return its index in the regex list,
+	or -1 if no word matches it.
+	In the bitmap, the index is the number of set bits below the key's bit
+*/
+int Regs::get_index(uint64 key) {
+	if( use_bitmap ) {
+		uint64 word = present[key/64];
+		uint64 bit = 1ULL << (key%64);
+		if( !(word & bit) ) return -1;
+		return rank[key/64] + __builtin_popcountll( word & (bit-1) );
+	}
+	uint64 slot = table_slot(key, table_mask);
+	while( table_keys[slot] != ~0ULL ) {
+		if( table_keys[slot] == key ) return table_index[slot];
+		slot = (slot+1) & table_mask;
 	}
+	return -1;
 }
 
 //  return the size of the regs list
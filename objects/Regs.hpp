@@ -5,8 +5,12 @@
 	Like a wordlist except the words are regular expressions
 	with asterisks as a wildcard for a single letter
 	
-	Stores the list of regexs, as well as a map that maps
-	a given regex to its index in the list
+	Stores the sorted list of regexs in a fixed-width table.
+	A regex is looked up by its packed integer key (see below)
+	in a bitmap with one bit per possible key, and the rank of the key's bit
+	in the bitmap is its index in the list.
+	For words longer than 5 the bitmap would be too large,
+	and a hash table from key to index is used instead
 
 	This software is distributed under 
 	the modified Berkeley Software Distribution (BSD) License.
@@ -15,20 +19,44 @@
 #ifndef REGS_HPP
 #define REGS_HPP
 
+/*
+	Packed regex keys, see pattern_key() in wsindex.hpp.
+	The coding keeps the sort order of the regex strings,
+	so the rank of a key among all keys is the index of the regex in the list.
+	Keys of up to BITMAPBITS bits, words of 5 characters or less,
+	are looked up in a bitmap over every possible key.
+	Longer keys are looked up in an open addressing hash table
+*/
+#define BITMAPBITS 25
+
 class Regs {
 
 	public:
 		Regs();
 		Regs(string);
+		Regs(Index*);
 		void read_regsfile(string);
-		int get_index(string);
+		int get_index(const string&);
+		int get_index(uint64);
 		int get_size();
 	
 	private:
-		vector<string> regs;
-		map<string,int> reg2index;
+		void build_lookup();
+		void build_table();
+
+		vector<char> buffer;	// owns the regex table when read from a text file
+		const char* regs;		// size*wordlen characters, sorted, no terminators
 		int size;
+		int wordlen;
 		string regsfile;
+
+		bool use_bitmap;		// keys fit in BITMAPBITS bits
+		vector<uint64> present;	// one bit per possible key, set if the key is a regex in the list
+		vector<int> rank;		// number of set bits before each word of present
+
+		vector<uint64> table_keys;	// hash table of keys, empty slots hold ~0
+		vector<int> table_index;	// regex index of each slot
+		uint64 table_mask;			// table size - 1, the size is a power of 2
 };
 
 #endif
@@ -0,0 +1,168 @@
+/*
+	Work-stealing scheduler implementation, Scheduler.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Each worker's deque is guarded by its own mutex.  Tasks are
+	whole subtrees, so a lock is taken once per subtree, not per search node.
+	The deque is a ring of capacity tasks: the back is first+count-1,
+	wrapped, and the front is first.
+	A worker that finds nothing to run or steal sleeps on a condition
+	variable until a task is pushed or the last one finishes,
+	rather than spinning on the cores of the workers that are busy.
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+/*
+	Create numworkers workers that run tasks with the given function,
+	each with room for capacity queued tasks
+*/
+template<int N>
+Scheduler<N>::Scheduler(int numworkers, int capacity, function<void(Task<N>&, Worker<N>*)> f) {
+	runtask = f;
+	pending = 0;
+	queued = 0;
+	sleeping = 0;
+	for(int i=0; i<numworkers; i++) {
+		Worker<N>* w = new Worker<N>();
+		w->id = i;
+		w->tasks.resize(capacity);
+		workers.push_back(w);
+	}
+}
+
+// free the workers
+template<int N>
+Scheduler<N>::~Scheduler() {
+	for(unsigned i=0; i<workers.size(); i++) {
+		delete workers[i];
+	}
+}
+
+/*
+	Push a task onto the back of a worker's deque.
+	Before run, tasks can be pushed to any worker to spread out the initial work.
+	Return false if the deque is full, the caller then runs the task itself
+*/
+template<int N>
+bool Scheduler<N>::push(Worker<N>* w, Task<N>& task) {
+	{
+		lock_guard<mutex> guard(w->lock);
+		if( w->count == w->tasks.size() ) return false;
+		w->tasks[ (w->first + w->count) % w->tasks.size() ] = task;
+		w->count++;
+		pending++;
+		queued++;
+	}
+	wake(false);
+	return true;
+}
+
+/*
+	Start a thread per worker, and return when every task,
+	including tasks pushed while running, is finished
+*/
+template<int N>
+void Scheduler<N>::run() {
+	vector<thread> threads;
+	for(unsigned i=0; i<workers.size(); i++) {
+		threads.push_back( thread(&Scheduler<N>::work, this, workers[i]) );
+	}
+	for(unsigned i=0; i<threads.size(); i++) {
+		threads[i].join();
+	}
+}
+
+/*
+	Worker loop.  Run tasks from the back of the worker's own deque,
+	steal from the other workers when it runs dry, wait when there's
+	nothing to steal, and stop when no task is left anywhere
+*/
+template<int N>
+void Scheduler<N>::work(Worker<N>* w) {
+	Task<N> task;
+	while( true ) {
+		if( pop(w, task) || steal(w, task) ) {
+			runtask(task, w);
+			if( --pending == 0 ) wake(true);
+		} else if( pending == 0 ) {
+			return;
+		} else {
+			unique_lock<mutex> guard(idlelock);
+			sleeping++;
+			idle.wait(guard, [this]() { return queued > 0 || pending == 0; });
+			sleeping--;
+		}
+	}
+}
+
+/*
+	wake one waiting worker for a task just pushed, or all of them 
+	when the last task is done.  A worker counts itself sleeping before
+	it checks for tasks, so with none counted there's no one to wake.
+	Taking the lock means a worker about to wait has either seen
+	the change or is already waiting
+*/
+template<int N>
+void Scheduler<N>::wake(bool all) {
+	if( sleeping == 0 ) return;
+	{
+		lock_guard<mutex> guard(idlelock);
+	}
+	if( all ) idle.notify_all();
+	else idle.notify_one();
+}
+
+// take the newest task from the back of the worker's own deque
+template<int N>
+bool Scheduler<N>::pop(Worker<N>* w, Task<N>& task) {
+	lock_guard<mutex> guard(w->lock);
+	if( w->count == 0 ) return false;
+	w->count--;
+	task = w->tasks[ (w->first + w->count) % w->tasks.size() ];
+	queued--;
+	return true;
+}
+
+/*
+	take the oldest task from the front of another worker's deque,
+	trying each of the other workers in turn starting after this one
+*/
+template<int N>
+bool Scheduler<N>::steal(Worker<N>* w, Task<N>& task) {
+	int n = workers.size();
+	for(int k=1; k<n; k++) {
+		Worker<N>* victim = workers[ (w->id + k) % n ];
+		lock_guard<mutex> guard(victim->lock);
+		if( victim->count > 0 ) {
+			task = victim->tasks[victim->first];
+			victim->first = (victim->first + 1) % victim->tasks.size();
+			victim->count--;
+			queued--;
+			return true;
+		}
+	}
+	return false;
+}
+
+// return the number of workers
+template<int N>
+int Scheduler<N>::get_numworkers() {
+	return workers.size();
+}
+
+// return a worker, to push initial tasks or collect results
+template<int N>
+Worker<N>* Scheduler<N>::get_worker(int i) {
+	return workers[i];
+}
+
+template class Scheduler<3>;
+template class Scheduler<4>;
+template class Scheduler<5>;
+template class Scheduler<6>;
+template class Scheduler<7>;
+template class Scheduler<8>;
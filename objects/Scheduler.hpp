@@ -0,0 +1,109 @@
+/*
+	Work-stealing scheduler header, Scheduler.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Runs wordsquare search tasks on a pool of threads.
+	A task is a partially filled square, the root of a search subtree.
+	Every worker thread has its own deque of tasks.  A worker pushes and pops
+	tasks at the back of its own deque, and when its deque is empty it steals
+	from the front of another worker's deque, where the oldest and usually
+	largest subtrees are.
+	A deque is a ring of tasks allocated once, when the scheduler is made,
+	so handing out work allocates nothing.  A push to a full ring fails
+	and the caller searches the subtree itself, as it would have
+	below the split depth.
+
+	In ordered mode, each worker also owns a buffer for the squares it finds, 
+	merged by Squares once every task is done.  Otherwise squares go 
+	straight to the Writer
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+/*
+	A subtree of the search.  
+	path lists the candidate chosen at each level above the subtree, 
+	starting with the seedsquare index, and orders the subtrees 
+	the way a single threaded search would visit them.
+	It's an array with room for every level, so a task copies
+	without allocating
+*/
+template<int N>
+struct Task {
+	Square<N> sqr;
+	Domains<N> dom;
+	int path[2*N+1];
+	int length;				// levels in path
+	int depth;
+
+	// set the path, at most 2*N+1 levels
+	void set_path(const vector<int>& p) {
+		length = p.size();
+		copy(p.begin(), p.end(), path);
+	}
+};
+
+/* per-thread search state and results */
+template<int N>
+struct Worker {
+	int id;
+	vector<int> path;					// path of the node being searched
+	vector<Square<N> > found;			// squares found by this worker, in ordered mode
+	vector<vector<int> > found_paths;	// and their paths
+	vector<int> buffer;					// candidate lists of the bitset engine, see Squares::buffer_at
+	long nodes = 0;						// search nodes visited by this worker
+	long solutions = 0;					// complete squares reached, duplicates too
+	NogoodCounts nogood;				// use of the nogood table
+
+	// time slicing, see Squares::generate_wordsquares
+	long budget = -1;					// nodes left in the slice, -1 for no limit
+	bool suspended = false;				// the slice ran out, or a checkpoint is due
+	vector<int> resume;					// path to continue from, empty to start fresh
+
+	// first level candidates lo to hi-1 of a shard, see Coordinator, hi -1 for all
+	int lo = 0;
+	int hi = -1;
+#ifdef WS_STATS
+	StatCounters counters;				// per depth statistics, see Stats.hpp
+	long mark[4];						// counter totals when the current seedsquare or task began
+#endif
+
+	vector<Task<N> > tasks;				// ring of queued tasks, sized once by the Scheduler
+	size_t first = 0;					// slot of the oldest task
+	size_t count = 0;					// tasks queued
+	mutex lock;
+};
+
+template<int N>
+class Scheduler {
+
+	public:
+		Scheduler(int, int, function<void(Task<N>&, Worker<N>*)>);
+		~Scheduler();
+
+		bool push(Worker<N>*, Task<N>&);
+		void run();
+
+		int get_numworkers();
+		Worker<N>* get_worker(int);
+
+	private:
+		void work(Worker<N>*);
+		bool pop(Worker<N>*, Task<N>&);
+		bool steal(Worker<N>*, Task<N>&);
+		void wake(bool);
+
+		vector<Worker<N>*> workers;
+		function<void(Task<N>&, Worker<N>*)> runtask;
+		atomic<long> pending;	// tasks pushed but not yet finished
+		atomic<long> queued;	// tasks pushed but not yet taken by a worker
+		atomic<int> sleeping;	// workers waiting on idle
+		mutex idlelock;
+		condition_variable idle;	// workers with nothing to run wait here
+};
+
+#endif
@@ -0,0 +1,54 @@
+/*
+	Set of seen square hashes implementation, Seen.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+// Default Constructor, an empty set
+Seen::Seen() {
+	size = 0;
+	duplicates = 0;
+}
+
+/*
+	Add a square's key to the set.
+	Return true if it's new, false if it was already seen
+*/
+bool Seen::insert(const string& key) {
+	int shard = hash<string>()(key) % SEEN_SHARDS;
+	lock_guard<mutex> guard(locks[shard]);
+	if( !shards[shard].insert(key).second ) {
+		duplicates++;
+		return false;
+	}
+	size++;
+	return true;
+}
+
+// return the number of distinct squares seen
+long Seen::get_size() {
+	return size;
+}
+
+// return the number of inserts that were duplicates
+long Seen::get_duplicates() {
+	return duplicates;
+}
+
+// append every key in the set to keys
+void Seen::get_all(vector<string>& keys) {
+	for(int i=0; i<SEEN_SHARDS; i++) {
+		lock_guard<mutex> guard(locks[i]);
+		keys.insert( keys.end(), shards[i].begin(), shards[i].end() );
+	}
+}
+
+// add saved keys back, with the number of duplicates dropped before
+void Seen::restore(vector<string>& keys, long dups) {
+	for(unsigned i=0; i<keys.size(); i++) insert(keys[i]);
+	duplicates += dups;
+}
@@ -0,0 +1,42 @@
+/*
+	Set of seen squares header, Seen.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Remembers the canonical keys of squares already found,
+	so duplicates can be dropped.  Safe to use from several threads,
+	the set is split into shards that each have their own lock.
+	The keys are the squares' grids, see Square::canonical_key,
+	so a square is only dropped when it really was written before.
+	Memory grows with every square kept, which is why dropping
+	duplicates is asked for with --dedupe
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef SEEN_HPP
+#define SEEN_HPP
+
+#define SEEN_SHARDS 64
+
+class Seen {
+
+	public:
+		Seen();
+
+		bool insert(const string&);
+		long get_size();
+		long get_duplicates();
+
+		// saving and restoring with a checkpoint
+		void get_all(vector<string>&);
+		void restore(vector<string>&, long);
+
+	private:
+		unordered_set<string> shards[SEEN_SHARDS];
+		mutex locks[SEEN_SHARDS];
+		atomic<long> size;
+		atomic<long> duplicates;
+};
+
+#endif
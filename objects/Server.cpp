@@ -0,0 +1,359 @@
+/*
+	Query server implementation, Server.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	The main thread accepts connections and queues them for the pool.
+	A pool thread reads a connection's requests one line at a time.
+	For a solve it runs the search on a thread of its own, while it
+	watches the connection for a cancel and the clock for the timeout,
+	and sets the search's stop flag on either.
+	Sends time out after SEND_TIMEOUT_MS, so a client that stops
+	reading can't hold its pool thread, the search's writer, or
+	the search's threads waiting on the writer, for good
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+/*
+	quote text as a JSON string for a reply that echoes what the client
+	sent.  Quotes and backslashes are escaped, and control characters
+	and bytes past ASCII are written as \\u escapes, so the reply
+	is one line of valid JSON whatever was sent
+*/
+static string json_string(const string& text) {
+	string out = "\"";
+	for(unsigned i=0; i<text.size(); i++) {
+		unsigned char c = text[i];
+		if( c == '"' || c == '\\' ) {
+			out += '\\';
+			out += c;
+		} else if( c < 0x20 || c >= 0x7f ) {
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", c);
+			out += code;
+		} else {
+			out += c;
+		}
+	}
+	return out + "\"";
+}
+
+// Serve on the socket at path with poolsize threads, searching with opts
+template<int N>
+Server<N>::Server(string str, int size, Options& o) {
+	path = str;
+	poolsize = size;
+	opts = o;
+	dict = NULL;
+	regs = NULL;
+	matches = NULL;
+	bitsets = NULL;
+	trie = NULL;
+	numqueries = 0;
+}
+
+/*
+	Listen on the socket, start the pool, and queue every connection accepted.
+	A socket file left by an earlier server is replaced.
+	Runs until the program is stopped
+*/
+template<int N>
+void Server<N>::run() {
+
+	// a client that goes away mid query must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if( path.size() >= sizeof(addr.sun_path) ) {
+		cout << "ERROR: socket path " << path << " is too long" << endl;
+		exit(-1);
+	}
+	strcpy(addr.sun_path, path.c_str());
+	unlink(path.c_str());
+
+	int listenfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if( listenfd < 0 || ::bind(listenfd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+		|| listen(listenfd, 128) < 0 ) {
+		cout << "ERROR: cannot listen on socket " << path << endl;
+		exit(-1);
+	}
+
+	vector<thread> pool;
+	for(int i=0; i<poolsize; i++) {
+		pool.push_back( thread(&Server<N>::work, this) );
+	}
+	cout << "serving " << N << "x" << N << " queries on " << path;
+	cout << " with " << poolsize << " threads" << endl;
+
+	while( true ) {
+		int fd = accept(listenfd, NULL, NULL);
+		if( fd < 0 ) {
+			if( errno == EINTR ) continue;
+			cout << "ERROR: accept failed on socket " << path << endl;
+			break;
+		}
+		struct timeval sendtimeout;
+		sendtimeout.tv_sec = SEND_TIMEOUT_MS / 1000;
+		sendtimeout.tv_usec = (SEND_TIMEOUT_MS % 1000) * 1000;
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &sendtimeout, sizeof(sendtimeout));
+		lock_guard<mutex> guard(lock);
+		pending.push_back(fd);
+		ready.notify_one();
+	}
+
+	::close(listenfd);
+	unlink(path.c_str());
+	exit(-1);
+}
+
+// pool thread loop, serve one queued connection after another
+template<int N>
+void Server<N>::work() {
+	while( true ) {
+		Connection conn;
+		{
+			unique_lock<mutex> guard(lock);
+			ready.wait(guard, [this]() { return !pending.empty(); });
+			conn.fd = pending.front();
+			pending.pop_front();
+		}
+		serve(conn);
+		::close(conn.fd);
+	}
+}
+
+/*
+	Read and answer requests until the client quits or hangs up,
+	or a reply can't be sent.
+	A bad request gets an error line, the connection stays open
+*/
+template<int N>
+void Server<N>::serve(Connection& conn) {
+	string line;
+	while( read_line(conn, line, -1, -1) == 1 ) {
+		vector<string> words;
+		size_t pos = 0;
+		while( pos < line.size() ) {
+			size_t end = line.find_first_of(" \t", pos);
+			if( end == string::npos ) end = line.size();
+			if( end > pos ) words.push_back( line.substr(pos, end-pos) );
+			pos = end+1;
+		}
+		if( words.empty() ) continue;
+
+		if( words[0] == "quit" ) {
+			return;
+		} else if( words[0] == "solve" ) {
+			long timeout = 0;
+			vector<string> seeds;
+			for(unsigned i=1; i<words.size(); i++) {
+				if( words[i].compare(0, 8, "timeout=") == 0 ) {
+					timeout = atol( words[i].c_str()+8 );
+				} else {
+					seeds.push_back(words[i]);
+				}
+			}
+			string error = Squares<N>::check_seedwords(seeds);
+			if( !error.empty() ) {
+				if( !send(conn, "{\"error\":" + json_string(error) + "}\n") ) return;
+				continue;
+			}
+			if( !solve(conn, seeds, timeout) ) return;
+		} else if( words[0] == "cancel" ) {
+			if( !send(conn, "{\"error\":\"no query running\"}\n") ) return;
+		} else {
+			if( !send(conn, "{\"error\":" + json_string("unknown request " + words[0]) + "}\n") ) return;
+		}
+	}
+}
+
+/*
+	Run one query and stream its squares to the connection.
+	The search runs on its own thread.  Meanwhile this thread waits for
+	it to end, a cancel line or a hang up from the client, or the timeout,
+	in milliseconds, 0 for none.  Either stops the search,
+	the squares found until then are still sent.
+	Other lines sent during a query are ignored.
+	Ends with a line giving the count, the status,
+	complete, timeout, or cancelled, and the runtime.
+	A square that can't be sent, because the client stopped reading
+	or went away, stops the search as if cancelled, and nothing more
+	is sent.  Return false if the connection is no longer usable
+*/
+template<int N>
+bool Server<N>::solve(Connection& conn, vector<string>& seeds, long timeout) {
+
+	auto start = chrono::steady_clock::now();
+	long id = ++numqueries;
+	atomic<bool> stop(false);
+	atomic<bool> done(false);
+	string status = "complete";
+	bool hungup = false;
+
+	Squares<N> squares(seeds);
+	squares.set_dict(dict);
+	squares.set_regs(regs);
+	squares.set_matches(matches);
+	squares.set_bitsets(bitsets);
+	squares.set_trie(trie);
+	squares.set_options(opts);
+	squares.set_verbose(false);
+	squares.set_stop(&stop);
+	Writer writer(conn.fd, "ndjson", N);
+	squares.set_writer(&writer);
+
+	// the search writes a byte to wake[1] when it ends, so the wait below ends with it
+	int wake[2];
+	if( pipe(wake) < 0 ) {
+		return send(conn, "{\"error\":\"out of file descriptors\"}\n");
+	}
+	thread search([&]() {
+		squares.generate_seedsquares();
+		squares.generate_wordsquares();
+		done = true;
+		char c = 0;
+		if( ::write(wake[1], &c, 1) < 0 ) {}
+	});
+
+	string line;
+	while( !done ) {
+		int wait = -1;
+		if( timeout > 0 && !stop ) {
+			long ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+			wait = ms < timeout ? timeout - ms : 0;
+		}
+		int got = read_line(conn, line, hungup ? -2 : wait, wake[0]);
+		if( done ) break;
+		if( got == -1 ) hungup = true;
+		if( (got == 1 && line == "cancel") || got == -1 ) {
+			if( !stop ) status = "cancelled";
+			stop = true;
+		} else if( got == 0 && wait >= 0 && !stop ) {
+			status = "timeout";
+			stop = true;
+		}
+	}
+	search.join();
+	writer.close();
+	::close(wake[0]);
+	::close(wake[1]);
+
+	long ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+	long count = squares.get_numfound();
+	bool open = !hungup && writer.get_error() == 0;
+	if( !hungup && writer.get_error() != 0 ) {
+		status = "send failed: " + string(strerror(writer.get_error()));
+	}
+	if( open ) {
+		open = send(conn, "{\"done\":true,\"count\":" + to_string(count) + ",\"status\":\"" + status
+			+ "\",\"ms\":" + to_string(ms) + "}\n");
+	}
+	string seedlist;
+	for(unsigned i=0; i<seeds.size(); i++) seedlist += " " + seeds[i];
+	log("query " + to_string(id) + ":" + seedlist + ", " + to_string(count) + " squares, "
+		+ status + ", " + to_string(ms) + " ms");
+	return open;
+}
+
+/*
+	Read the next line from a connection into line, without the newline.
+	Wait at most timeout milliseconds, -1 to wait for good,
+	or until wakefd, if not -1, is readable.  A timeout of -2 waits only
+	for wakefd, for a connection that has hung up.
+	Return 1 with a line, 0 on timeout or wake up, -1 if the client hung up
+*/
+template<int N>
+int Server<N>::read_line(Connection& conn, string& line, int timeout, int wakefd) {
+	while( true ) {
+		size_t nl = conn.inbuf.find('\n');
+		if( timeout != -2 && nl != string::npos ) {
+			line = conn.inbuf.substr(0, nl);
+			conn.inbuf.erase(0, nl+1);
+			if( !line.empty() && line[line.size()-1] == '\r' ) line.erase(line.size()-1);
+			return 1;
+		}
+		struct pollfd p[2];
+		p[0].fd = timeout == -2 ? -1 : conn.fd;
+		p[0].events = POLLIN;
+		p[0].revents = 0;
+		p[1].fd = wakefd;
+		p[1].events = POLLIN;
+		p[1].revents = 0;
+		int numready = poll(p, 2, timeout < 0 ? -1 : timeout);
+		if( numready == 0 ) return 0;
+		if( numready < 0 ) {
+			if( errno == EINTR ) continue;
+			return -1;
+		}
+		if( p[1].revents ) return 0;
+		char buf[4096];
+		ssize_t n = read(conn.fd, buf, sizeof(buf));
+		if( n <= 0 ) return -1;
+		conn.inbuf.append(buf, n);
+	}
+}
+
+/*
+	Write a whole reply to a connection.  Return false if the client
+	is gone, or stopped reading and the send timed out
+*/
+template<int N>
+bool Server<N>::send(Connection& conn, string reply) {
+	size_t done = 0;
+	while( done < reply.size() ) {
+		ssize_t n = ::write(conn.fd, reply.data()+done, reply.size()-done);
+		if( n < 0 && errno == EINTR ) continue;
+		if( n <= 0 ) return false;
+		done += n;
+	}
+	return true;
+}
+
+// print one line of the server log, lines from different threads don't mix
+template<int N>
+void Server<N>::log(string msg) {
+	lock_guard<mutex> guard(loglock);
+	cout << msg << endl;
+}
+
+// set the wordlist object
+template<int N>
+void Server<N>::set_dict(Dict *d) {
+	dict = d;
+}
+
+// set the precomputed regs object
+template<int N>
+void Server<N>::set_regs(Regs *r) {
+	regs = r;
+}
+
+// set the precomputed match matrix
+template<int N>
+void Server<N>::set_matches(Matches *m) {
+	matches = m;
+}
+
+// set the bitset engine, used in place of regs and matches
+template<int N>
+void Server<N>::set_bitsets(Bitsets *b) {
+	bitsets = b;
+}
+
+// set the trie engine
+template<int N>
+void Server<N>::set_trie(Trie *t) {
+	trie = t;
+}
+
+template class Server<3>;
+template class Server<4>;
+template class Server<5>;
+template class Server<6>;
+template class Server<7>;
+template class Server<8>;
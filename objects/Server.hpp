@@ -0,0 +1,75 @@
+/*
+	Query server header, Server.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Answers seed queries over a Unix domain socket, so the wordlist
+	and its index are loaded once for any number of queries.
+	Connections are served by a fixed pool of threads that share
+	the loaded Dict, Regs, Matches, Bitsets, or Trie, which are only read.
+	A connection holds its pool thread until it closes.
+
+	The protocol is line based, see the README for details:
+		solve [timeout=MS] seedword seedword seedword ...
+		cancel
+		quit
+	Solutions stream back as NDJSON lines as they are found,
+	followed by a line that reports the count and how the query ended.
+
+	Templated on the width of the square, like Squares
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+// ms a send to a client may wait on a client that isn't reading, before the query is dropped
+#define SEND_TIMEOUT_MS 10000
+
+/* a client connection, with what's been read of a line not yet finished */
+struct Connection {
+	int fd;
+	string inbuf;
+};
+
+template<int N>
+class Server {
+
+	public:
+		Server(string, int, Options&);
+
+		void set_dict(Dict*);
+		void set_regs(Regs*);
+		void set_matches(Matches*);
+		void set_bitsets(Bitsets*);
+		void set_trie(Trie*);
+
+		void run();
+
+	private:
+		void work();
+		void serve(Connection&);
+		bool solve(Connection&, vector<string>&, long);
+		int read_line(Connection&, string&, int, int);
+		bool send(Connection&, string);
+		void log(string);
+
+		string path;
+		int poolsize;
+		Options opts;
+
+		Dict *dict;
+		Regs *regs;
+		Matches *matches;
+		Bitsets *bitsets;
+		Trie *trie;
+
+		deque<int> pending;			// accepted connections waiting for a pool thread
+		mutex lock;
+		condition_variable ready;
+		mutex loglock;
+		atomic<long> numqueries;
+};
+
+#endif
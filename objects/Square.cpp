@@ -12,104 +12,236 @@
 #include "wslib.hpp"
 
 /* 
-	Default Constructor, create a vector of 2*wordlen words
-	and another vector that tracks whether an index to words is occupied
+	Default Constructor, an empty grid with no word positions assigned
 */
+template<int N>
+Square<N>::Square(){
+	for(int i=0; i<N*N; i++) {
+		grid[i] = '*';
+	}
+	assigned = 0;
+	pending = 0;
+}
+
+/*
+	return the grid offset of character pos of the word at index,
+	pos across a row or pos down a column
+*/
+template<int N>
+int Square<N>::cell(int index, int pos) {
+	if(index < N) {
+		return index*N + pos;
+	}
+	return pos*N + index-N;
+}
 
-Square::Square(){
-	string init = "*****";
-	for(int i=0; i<2*WORDLEN; i++) {
-		words.push_back(init);
-		assigned.push_back(0);
-	}	
+// return the word at a given index, with '*' for unfilled cells
+template<int N>
+string Square<N>::get_word(int index) {
+	string word(N, '*');
+	for(int i=0; i<N; i++) {
+		word[i] = grid[ cell(index, i) ];
+	}
+	return word;
 }
 
-// set a given word to a given index
-void Square::set_word(int index, string word) {
-	words[index]=word;
+// return character pos of the word at index
+template<int N>
+char Square<N>::get_char(int index, int pos) {
+	return grid[ cell(index, pos) ];
 }
 
 // test if a given index position has been assigned a word
-bool Square::empty_at(int index) {
-	return !assigned[index];
+template<int N>
+bool Square<N>::empty_at(int index) {
+	return !(assigned & (1 << index));
 }
 
-// assign a given index a given word, mark as assigned
-void Square::assign(string word, int index) {
-	words[index] = word;
-	assigned[index] = true;
+/*
+	test if a word can be assigned at a given index.
+	Only the cells of that position are checked: a cell already 
+	filled by a crossing word must hold the same character
+*/
+template<int N>
+bool Square<N>::fits(const char* word, int index) {
+	char c;
+	for(int i=0; i<N; i++) {
+		c = grid[ cell(index, i) ];
+		if( c != '*' && c != word[i] ) {
+			return false;
+		}
+	}
+	return true;
 }
 
-// unassign a given index
-void Square::unassign(int index) {
-	string init = "*****";
-	assigned[index] = false;
-	words[index] = init;
+// return the seedwords that must still be placed, bit k for seedword k
+template<int N>
+unsigned Square<N>::get_pending() {
+	return pending;
 }
 
-/* 
-	test if the wordsquare properties hold 
+// set the seedwords that must still be placed
+template<int N>
+void Square<N>::set_pending(unsigned p) {
+	pending = p;
+}
+
+// assign a given index a given word, mark as assigned
+template<int N>
+void Square<N>::assign(const char* word, int index) {
+	for(int i=0; i<N; i++) {
+		grid[ cell(index, i) ] = word[i];
+	}
+	assigned |= 1 << index;
+}
+
+/*
+	unassign a given index.
+	Cells shared with an assigned crossing word keep their character
 */
-bool Square::test_layout() {
-	for(int i=0; i<2*WORDLEN; i++) {
-		if( assigned[i] ) {		
-			if(i<WORDLEN) {
-				for(int j=0; j<WORDLEN; j++) {
-					if( assigned[j+WORDLEN] ) {
-						if( words[i][j] != words[j+WORDLEN][i] ) {
-							return false;
-						}
-					}
-				}
-			} else {
-				for(int j=0; j<WORDLEN; j++) {
-					if( assigned[j] ) {
-						if( words[i][j] != words[j][i-WORDLEN] ) {
-							return false;
-						}
-					}
-				}
-			}	
+template<int N>
+void Square<N>::unassign(int index) {
+	assigned &= ~(1 << index);
+	int cross;
+	for(int i=0; i<N; i++) {
+		cross = index < N ? i+N : i;
+		if( empty_at(cross) ) {
+			grid[ cell(index, i) ] = '*';
 		}
 	}
-	return true;
 }
 
 // return the index of the first unassigned word
-int Square::get_next_index() {
-	for(int i=0; i<2*WORDLEN; i++) {
-		if( assigned[i]==false) {
+template<int N>
+int Square<N>::get_next_index() {
+	for(int i=0; i<2*N; i++) {
+		if( empty_at(i) ) {
 			return i;
 		}
 	}
-	return 2*WORDLEN;
+	return 2*N;
 }
 
 /*
-	return the regex of a given position
+	return the regex of a given position,
+	its cells as filled in by the crossing words
 */
-string Square::get_constraint(int index) {
-	string constraint(5,'*');
-	if(index < WORDLEN ) {
-		for(int i=0; i<WORDLEN; i++) {
-			constraint[i] = words[i+WORDLEN][index];
-		}
-	} else {
-		for(int i=0; i<WORDLEN; i++) {
-			constraint[i] = words[i][index-WORDLEN];
+template<int N>
+string Square<N>::get_constraint(int index) {
+	return get_word(index);
+}
+
+/*
+	return the packed regex key of a given position,
+	the same key as pattern_key(get_constraint(index), N)
+	without building the regex string
+*/
+template<int N>
+uint64 Square<N>::get_constraint_key(int index) {
+	uint64 key = 0;
+	for(int i=0; i<N; i++) {
+		key = (key << KEYBITS) | key_code( grid[ cell(index, i) ] );
+	}
+	return key;
+}
+
+// test if two word positions cross, i.e. one is a row and the other a column
+template<int N>
+bool Square<N>::crosses(int a, int b) {
+	return (a < N) != (b < N);
+}
+
+/*
+	return the domain of the cell at position pos of the word at index,
+	the same cell that get_constraint reads for that position
+*/
+template<int N>
+unsigned& Square<N>::domain_at(Domains<N>* dom, int index, int pos) {
+	if(index < N) {
+		return dom->cell[index][pos];
+	}
+	return dom->cell[pos][index-N];
+}
+
+/*
+	return the square flipped about its diagonal,
+	rows become columns and columns become rows
+*/
+template<int N>
+Square<N> Square<N>::transpose() {
+	Square<N> t;
+	for(int r=0; r<N; r++) {
+		for(int c=0; c<N; c++) {
+			t.grid[c*N+r] = grid[r*N+c];
 		}
 	}
-	return constraint;
+	unsigned short rows = assigned & ((1 << N)-1);
+	t.assigned = (rows << N) | (assigned >> N);
+	t.pending = pending;
+	return t;
+}
+
+/*
+	return a key that is the same for a square and its transpose,
+	and differs for any two squares that aren't, so it's compared
+	rather than trusted like a hash.
+	The canonical form is whichever of the two has the smaller grid,
+	then the smaller assigned mask.  The key is its grid, 
+	and for a partial square ':' and its assigned mask
+*/
+template<int N>
+string Square<N>::canonical_key() {
+	Square<N> t = transpose();
+	int cmp = memcmp(grid, t.grid, sizeof(grid));
+	Square<N>* canon = this;
+	if( cmp > 0 || (cmp == 0 && t.assigned < assigned) ) canon = &t;
+
+	string key(canon->grid, sizeof(grid));
+	if( canon->assigned != (1 << 2*N)-1 ) key += ":" + to_string(canon->assigned);
+	return key;
+}
+
+/*
+	return a hash of the grid, the assigned word positions, and the
+	seedwords still to place, everything that decides how a partial
+	square can be completed.
+	Never 0, the empty slot of the Nogoods table.
+	A second hash of the same, mixed with other constants, goes in check,
+	so the Nogoods table can tell apart squares whose hashes collide.
+	Called at every search node, so it mixes 8 characters at a time
+*/
+template<int N>
+uint64 Square<N>::partial_hash(uint64* check) {
+	uint64 h = 0x9e3779b97f4a7c15ULL ^ assigned ^ ((uint64)pending << 16);
+	uint64 c = 0x2545f4914f6cdd1dULL ^ ((uint64)assigned << 40) ^ pending;
+	uint64 chunk;
+	int i = 0;
+	for(; i+8 <= N*N; i+=8) {
+		memcpy(&chunk, grid+i, 8);
+		h = (h ^ chunk) * 0xff51afd7ed558ccdULL;
+		h ^= h >> 32;
+		c = (c + chunk) * 0x94d049bb133111ebULL;
+		c ^= c >> 31;
+	}
+	chunk = 0;
+	memcpy(&chunk, grid+i, N*N-i);
+	h = (h ^ chunk) * 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 29;
+	c = (c + chunk) * 0xbf58476d1ce4e5b9ULL;
+	c ^= c >> 27;
+	*check = c;
+	return h == 0 ? 1 : h;
 }
 
 /*
 	print just the square, half the words
 */
-void Square::print_square() {
+template<int N>
+void Square<N>::print_square() {
 	
-	for(int i=0; i<WORDLEN; i++) {
-		for(int j=0; j<WORDLEN; j++) {
-			cout << words[i][j] << " ";
+	for(int i=0; i<N; i++) {
+		for(int j=0; j<N; j++) {
+			cout << grid[i*N+j] << " ";
 		}
 		cout << endl;
 	}
@@ -120,10 +252,11 @@ void Square::print_square() {
 /*
 	print all the words, for completness
 */
-void Square::print_words() {
+template<int N>
+void Square<N>::print_words() {
 	
-	for(int i=0; i<2*WORDLEN; i++) {
-		cout << i << ": " << words[i] << endl;
+	for(int i=0; i<2*N; i++) {
+		cout << i << ": " << get_word(i) << endl;
 	}
 
 	return;
@@ -132,10 +265,24 @@ void Square::print_words() {
 /*
 	write all the words to a given output stream
 */
-void Square::write_words(ofstream& outstream) {
+template<int N>
+void Square<N>::write_words(ofstream& outstream) {
 
-	for(int i=0; i<2*WORDLEN; i++) {
-		outstream << i << ": " << words[i] << endl;
+	for(int i=0; i<2*N; i++) {
+		outstream << i << ": " << get_word(i) << endl;
 	}
 
 }
+
+// return the grid, N*N characters row by row, not null terminated
+template<int N>
+const char* Square<N>::get_grid() {
+	return grid;
+}
+
+template class Square<3>;
+template class Square<4>;
+template class Square<5>;
+template class Square<6>;
+template class Square<7>;
+template class Square<8>;
@@ -11,19 +11,69 @@
 #ifndef SQUARE_HPP
 #define SQUARE_HPP
 
+/*
+	Letter domains for forward checking.
+	Every cell of the square has a bitmask of the characters it may still take,
+	bits 0 through 25 for 'a' through 'z' and bit 26 for '-'.
+	A cell is shared by the row and the column that cross at it
+*/
+#define ALLCHARS ((1u << 27)-1)
+
+inline unsigned char_bit(char c) {
+	if( c == '-' ) return 1u << 26;
+	return 1u << (c - 'a');
+}
+
+// the character of bit b of a domain, the inverse of char_bit
+inline char bit_char(int b) {
+	if( b == 26 ) return '-';
+	return 'a' + b;
+}
+
+template<int N>
+struct Domains {
+	unsigned cell[N][N];	// [row][column]
+};
+
+/*
+	A square of width N, N from MINLEN to MAXLEN,
+	with explicit instantiations for each in Square.cpp.
+	Every loop over a word runs a compile time number of times.
+
+	The square is stored as an N*N grid of characters, row by row,
+	with '*' in cells no assigned word covers.  A row reads the grid across
+	and a column reads the same grid with a stride of N,
+	so a cell shared by a row and a column is stored once.
+	Word positions 0 to N-1 are the rows, N to 2*N-1 the columns,
+	and a bitmask records which of them are assigned.
+	Another bitmask records the seedwords the search must still place.
+	The object is plain data, copying it is a small memcpy
+*/
+template<int N>
 class Square {
 
 	public:
 		Square();
 
-		void set_word(int, string);
+		string get_word(int);
+		char get_char(int, int);
 		bool empty_at(int);
-		bool test_layout();
+		bool fits(const char*, int);
+		unsigned get_pending();
+		void set_pending(unsigned);
 
-		void assign(string, int);
+		void assign(const char*, int);
 		void unassign(int);
 		int get_next_index();
 		string get_constraint(int);
+		uint64 get_constraint_key(int);
+		bool crosses(int, int);
+		unsigned& domain_at(Domains<N>*, int, int);
+		const char* get_grid();
+
+		Square transpose();
+		string canonical_key();
+		uint64 partial_hash(uint64*);
 
 		void print_square();
 		void print_words();
@@ -31,8 +81,11 @@ class Square {
 		void write_words(ofstream&);
 
 	private:
-		vector<string> words;
-		vector<int> assigned;
+		int cell(int, int);
+
+		char grid[N*N];
+		unsigned short assigned;	// bit i set if word position i is assigned
+		unsigned short pending;		// bit k set if seedword k must still be placed, see Squares::gen_ss
 };
 
 #endif
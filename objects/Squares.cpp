@@ -7,7 +7,7 @@
 		- Reads in auxiliary data structures
 		- Generate seed squares from seed words
 		- Generates solution squares from seed squares and wordlists
-		- Writes results to output file
+		- Streams results to the Writer
 
 	This software is distributed under 
 	the modified Berkeley Software Distribution (BSD) License.
@@ -16,53 +16,94 @@
 #include "wslib.hpp"
 
 // Default Constructor
-Squares::Squares() {}
+template<int N>
+Squares<N>::Squares() {
+	bitsets = NULL;
+	trie = NULL;
+	numthreads = 1;
+	ordered = false;
+	split_depth = 2;
+	scheduler = NULL;
+	numprocs = 1;
+	worker_mem = 0;
+	writer = NULL;
+	forward_check = true;
+	nogoods = NULL;
+	nogood_mb = 0;
+	top = 0;
+	numranked = 0;
+	placed = 0;
+	seed_tree = false;
+	dynamic_order = true;
+	root_ac = true;
+	dedupe = false;
+	dup_seeds = 0;
+	stop = NULL;
+	verbose = true;
+	tag = 0;
+	numfound = 0;
+	numnodes = 0;
+	stats = NULL;
+	max_solutions = 0;
+	deadline = 0;
+	max_per_seed = 0;
+	halted = false;
+	numaccepted = 0;
+	numfinished = 0;
+	numalive = 0;
+	numcapped = 0;
+	checkpoint = NULL;
+	checkpoint_due = false;
+}
 
 // Constructor with an input seedfile
-Squares::Squares(string str) {
+template<int N>
+Squares<N>::Squares(string str) : Squares() {
 	seedfile = str;
 	read_seedfile();
 }
 
+/*
+	Constructor with a list of seedwords,
+	which should have passed check_seedwords
+*/
+template<int N>
+Squares<N>::Squares(vector<string>& words) : Squares() {
+	seedwords = words;
+	seedsize = seedwords.size();
+}
+
+// Destructor, frees the nogood table
+template<int N>
+Squares<N>::~Squares() {
+	delete nogoods;
+}
+
 /*
 	read in a file that contains the seed words
 	formatted with first line number of seed words,
 	followed by each specific seed word.
 	Read seed words into seed words vector.
 */
-void Squares::read_seedfile() {
+template<int N>
+void Squares<N>::read_seedfile() {
 
 	cout << "reading seedfile: " << seedfile << endl;
 	ifstream instream;
 	instream.open(seedfile.c_str());
-	seedsize=0;
 	
 	string line;
 	
 	while( getline(instream, line)) {
-		seedsize++;
-		if(seedsize>10) {
-			cout << "ERROR: MORE THAN 10 SEEDWORDS"<<endl;
-			cout << "exiting program" << endl;
-			exit(-1);
-		} 
-		if(line.size() > WORDLEN) {
-			cout << "ERROR: seedword " << line << " exceeds wordlength " << WORDLEN << endl;
-			cout << "exiting program" << endl;
-			exit(-1);
-		} else if(line.size() < WORDLEN) {
-			cout << "ERROR: seedword " << line << " less than wordlength " << WORDLEN << endl;
-			cout << "try adding '-' characters for empty spaces" << endl;
-			cout << "exiting program" << endl;
-			exit(-1);
-		}
 		seedwords.push_back(line);
 	}	
-	if(seedsize<3) {
-		cout << "ERROR: LESS THAN 3 SEEDWORDS"<<endl;
+	string error = check_seedwords(seedwords);
+	if( !error.empty() ) {
+		cout << "ERROR: " << error << endl;
 		cout << "exiting program" << endl;
 		exit(-1);
 	}
+	seedsize = seedwords.size();
 	
 	cout << "loaded " << seedsize << " seedwords" << endl << endl;
 
@@ -71,64 +112,626 @@ void Squares::read_seedfile() {
 	return;
 }
 
+/*
+	Check a list of seedwords, return what's wrong with it or "" if nothing.
+	There must be 3 to 10 seedwords of 1 to N characters,
+	lower case letters or '-' for an empty space.
+	A seedword shorter than N may go at any alignment, see make_forms
+*/
+template<int N>
+string Squares<N>::check_seedwords(vector<string>& words) {
+	if( words.size() > 10 ) {
+		return "MORE THAN 10 SEEDWORDS";
+	}
+	for(unsigned i=0; i<words.size(); i++) {
+		string& word = words[i];
+		if( word.size() > N ) {
+			return "seedword " + word + " exceeds wordlength " + to_string(N);
+		} else if( word.empty() ) {
+			return "an empty seedword";
+		}
+		for(unsigned j=0; j<word.size(); j++) {
+			if( word[j] != '-' && (word[j] < 'a' || word[j] > 'z') ) {
+				return "seedword " + word + " has a character other than a-z or '-'";
+			}
+		}
+	}
+	if( words.size() < 3 ) {
+		return "LESS THAN 3 SEEDWORDS";
+	}
+	return "";
+}
+
 /*
 	Public-facing generate all seedsquares function.
-	Generate all possible layouts with the provided seed words.
+	Generate all possible layouts with the provided seed words,
+	or with a seed tree of the first seedword only.
+	Seedwords shorter than N are left to the search, 
+	except with the trie engine, which can't place them.
 	Initialize an empty square and pass it to the private gen_ss method.
 	Number of words incorporated in the seedsquare is 0
 */
-void Squares::generate_seedsquares() {
+template<int N>
+void Squares<N>::generate_seedsquares() {
 
-	Square seedsquare, *p_sqr = &seedsquare;
+	Square<N> seedsquare, *p_sqr = &seedsquare;
+
+	make_forms();
+	placed = 0;
+	for(int k=0; k<seedsize; k++) {
+		if( trie != NULL ) placed |= 1u << k;
+		else if( (int)seedwords[k].size() == N && !(seed_tree && placed != 0) ) placed |= 1u << k;
+	}
 	
 	gen_ss(p_sqr, 0);
 	
 	num_seedsquares=squares.size();
+	if( verbose ) {
+		cout << "skipped " << dup_seeds << " duplicate seedsquares" << endl;
+	}
+	if( placed != (1u << seedsize) - 1 && verbose ) {
+		cout << "placed " << __builtin_popcount(placed) << " of " << seedsize;
+		cout << " seedwords, the search places the rest" << endl;
+	}
 	
 	return;
 }
 
+/*
+	List every form of each seedword, the ways it can fill a word position.
+	A seedword of N characters is its own form.  A shorter one is
+	padded with '-' to N characters at each alignment, so a 3 letter
+	seedword of a 5x5 square has 3 forms, "abc--", "-abc-", and "--abc".
+	Forms that come out the same are listed once
+*/
+template<int N>
+void Squares<N>::make_forms() {
+	forms.clear();
+	formseed.clear();
+	firstform.assign(1, 0);
+	for(int k=0; k<seedsize; k++) {
+		int pad = N - seedwords[k].size();
+		for(int s=0; s<=pad; s++) {
+			string form = string(s, '-') + seedwords[k] + string(pad-s, '-');
+			if( find(forms.begin() + firstform[k], forms.end(), form) != forms.end() ) continue;
+			forms.push_back(form);
+			formseed.push_back(k);
+		}
+		firstform.push_back( forms.size() );
+	}
+}
+
 /*
 	Public generate all wordsquare method
-	For every seedsquare, call generate wordsquare
+	For every seedsquare, call generate wordsquare.
+	Seedsquares found to have no solution while setting up
+	their letter domains are skipped.
+
+	With more than one thread, every seedsquare becomes a task
+	for the work-stealing scheduler, dealt round robin to the workers,
+	and the first split_depth levels of each search spawn their subtrees as tasks,
+	as many as fit a worker's TASK_SLOTS, the rest it searches itself.
+	Solved squares go to the writer as they are found, except in ordered mode,
+	where the squares found by each worker are merged at the end.
+
+	The search stops early when a limit of set_options is reached,
+	and get_status tells whether it was complete.
+	With a deadline or a solution limit, or a checkpoint, a single threaded
+	search of the regex engines goes through a queue of seedsquares, see search_queue.
+	With more than one process, the regex engines split the search
+	between worker processes, see search_shards
 */
-void Squares::generate_wordsquares() {
+template<int N>
+void Squares<N>::generate_wordsquares() {
 
+	start = chrono::steady_clock::now();
 	int numseeds = squares.size();
-	Square sqr;
+	vector<atomic<long> > counts(numseeds);
+	seedfound.swap(counts);
+	for(int i=0; i<numseeds; i++) seedfound[i] = 0;
+	vector<Domains<N> > seeddoms;
+	vector<bool> alive;
+	prepare_seedsquares(seeddoms, alive);
+	numalive = count(alive.begin(), alive.end(), true);
+	if( nogood_mb > 0 && trie == NULL && nogoods == NULL && top == 0 ) {
+		nogoods = new Nogoods(nogood_mb);
+	}
+
+	if( numprocs > 1 && trie == NULL ) {
+		search_shards(seeddoms, alive);
+		return;
+	}
+
+	if( numthreads <= 1 && trie == NULL && (deadline > 0 || max_solutions > 0 || checkpoint != NULL) ) {
+		search_queue(seeddoms, alive);
+		if( top > 0 ) write_top();
+		return;
+	}
+
+	if( numthreads <= 1 ) {
+		Worker<N> worker;
+		worker.id = 0;
+		init_worker(&worker);
+		STAT( if( stats ) stats->set_numseeds(numseeds); )
+		STAT( if( stats ) stats->add(&worker.counters); )
+		Square<N> sqr;
+		for(int i=0; i<numseeds; i++) {
+			if( stopped() ) break;
+			if( !alive[i] ) continue;
+			sqr = squares[i];
+			worker.path.assign(1, i);
+			STAT( Stats::mark(&worker.counters, worker.mark); )
+			if( trie != NULL ) start_rows(&sqr, &worker, 0);
+			else gen_ws(&sqr, &seeddoms[i], &worker, 0);
+			STAT( if( stats ) stats->add_seed(i, &worker.counters, worker.mark); )
+			if( !stopped() ) numfinished++;
+		}
+		STAT( if( stats ) stats->retire(&worker.counters); )
+		add_counts(&worker);
+		if( top > 0 ) write_top();
+		return;
+	}
+
+	// room for each worker's share of the seedsquares, and the tasks they split into
+	int capacity = (numalive + numthreads-1) / numthreads + TASK_SLOTS;
+	scheduler = new Scheduler<N>( numthreads, capacity,
+		[this](Task<N>& task, Worker<N>* w) { run_task(task, w); } );
+	STAT( if( stats ) stats->set_numseeds(numseeds); )
+	for(int i=0; i<numthreads; i++) {
+		init_worker( scheduler->get_worker(i) );
+		STAT( if( stats ) stats->add(&scheduler->get_worker(i)->counters); )
+	}
+	Task<N> task;
 	for(int i=0; i<numseeds; i++) {
-		sqr = squares[i];
-		gen_ws(&sqr);
+		if( !alive[i] ) continue;
+		task.sqr = squares[i];
+		task.dom = seeddoms[i];
+		task.path[0] = i;
+		task.length = 1;
+		task.depth = 0;
+		scheduler->push( scheduler->get_worker(i%numthreads), task );
 	}
+	scheduler->run();
+	for(int i=0; i<numthreads; i++) {
+		add_counts( scheduler->get_worker(i) );
+		STAT( if( stats ) stats->retire(&scheduler->get_worker(i)->counters); )
+	}
+	merge_found(scheduler);
+	delete scheduler;
+	scheduler = NULL;
+
 	return;
 }
 
+/*
+	Single threaded search of a queue of seedsquares.
+	
+	With a deadline or a solution limit, the seedsquares take turns,
+	so the limit isn't spent on the first seedsquares while the rest wait.
+	Each turn searches at most SLICE_NODES nodes of one seedsquare, 
+	then the seedsquare goes to the back of the queue with the path 
+	where its search stopped.  Its next turn replays that path from
+	the seedsquare, which is cheap, the path is at most 2*N long, 
+	and carries on from there.
+	The squares of every seedsquare are found, only in another order.
+
+	With a checkpoint, the search also stops when one is due,
+	see check_clock, and the queue with every path is saved.
+	The seedsquare stopped goes back to the front with what's left
+	of its turn, so the squares come in the same order as without a checkpoint.
+	A search resumed from a checkpoint starts with its queue.
+	The checkpoint is deleted once the search ends, unless SIGTERM ended it
+*/
+template<int N>
+void Squares<N>::search_queue(vector<Domains<N> >& seeddoms, vector<bool>& alive) {
+
+	int numseeds = squares.size();
+	bool turns = deadline > 0 || max_solutions > 0;
+	Worker<N> worker;
+	worker.id = 0;
+	init_worker(&worker);
+	STAT( if( stats ) stats->set_numseeds(numseeds); )
+	STAT( if( stats ) stats->add(&worker.counters); )
+
+	deque<int> queue;
+	vector<vector<int> > resume(numseeds);
+	long slice = -1;		// nodes left in the turn of the front seedsquare, -1 for a new turn
+	if( checkpoint != NULL && checkpoint->resumed ) {
+		restore_checkpoint(queue, resume);
+		slice = checkpoint->slice;
+	} else {
+		for(int i=0; i<numseeds; i++) {
+			if( alive[i] ) queue.push_back(i);
+		}
+	}
+
+	Square<N> sqr;
+	Domains<N> dom;
+	while( !queue.empty() && !stopped() ) {
+		int i = queue.front();
+		queue.pop_front();
+		sqr = squares[i];
+		dom = seeddoms[i];
+		worker.path.assign(1, i);
+		worker.resume = resume[i];
+		worker.budget = !turns ? -1 : slice >= 0 ? slice : SLICE_NODES;
+		worker.suspended = false;
+		slice = -1;
+		STAT( Stats::mark(&worker.counters, worker.mark); )
+		gen_ws(&sqr, &dom, &worker, 0);
+		STAT( if( stats ) stats->add_seed(i, &worker.counters, worker.mark); )
+		if( stopped() ) break;
+		if( worker.suspended && !(max_per_seed > 0 && seedfound[i] >= max_per_seed) ) {
+			resume[i] = worker.resume;
+			if( worker.budget != 0 ) {
+				queue.push_front(i);
+				if( turns ) slice = worker.budget;
+			} else {
+				queue.push_back(i);
+			}
+		} else {
+			resume[i].clear();
+			numfinished++;
+		}
+		if( checkpoint_due ) {
+			numnodes += worker.nodes;
+			worker.nodes = 0;
+			checkpoint->slice = slice;
+			save_checkpoint(queue, resume);
+			checkpoint_due = false;
+			if( Checkpoint::terminated() ) {
+				halt("terminated");
+				if( verbose ) cout << "terminated, saved checkpoint " << checkpoint->get_file() << endl;
+			}
+		}
+	}
+	STAT( if( stats ) stats->retire(&worker.counters); )
+	add_counts(&worker);
+	// a terminated search resumes from its checkpoint, and so does one whose output failed
+	if( checkpoint != NULL && !(halted && (halt_reason == "terminated" || halt_reason == "write failed")) ) {
+		checkpoint->remove();
+	}
+}
+
+/*
+	Start a resumed search where its checkpoint left off: 
+	the queue of seedsquares with their paths, the squares written, 
+	and the counters of the limits.  The checkpoint must be of the same
+	seedwords, wordlist, and settings, or the program exits
+*/
+template<int N>
+void Squares<N>::restore_checkpoint(deque<int>& queue, vector<vector<int> >& resume) {
+
+	Checkpoint* cp = checkpoint;
+	string mismatch;
+	if( cp->seedwords != seedwords ) mismatch = "seedwords";
+	else if( cp->numseeds != (int)squares.size() ) mismatch = "seedsquares";
+	else if( cp->dictsize != dict->get_size() ) mismatch = "wordlist";
+	else if( cp->settings != get_settings() ) mismatch = "search settings";
+	for(unsigned i=0; mismatch.empty() && i<cp->queue.size(); i++) {
+		int seed = cp->queue[i].path[0];
+		if( seed < 0 || seed >= (int)squares.size() ) mismatch = "seedsquares";
+	}
+	if( !mismatch.empty() ) {
+		cout << "ERROR: checkpoint " << cp->get_file() << " was taken with other " << mismatch << endl;
+		cout << "exiting program" << endl;
+		exit(-1);
+	}
+
+	for(unsigned i=0; i<cp->queue.size(); i++) {
+		int seed = cp->queue[i].path[0];
+		queue.push_back(seed);
+		resume[seed] = cp->queue[i].path;
+		seedfound[seed] = cp->queue[i].found;
+	}
+	seen_solutions.restore(cp->seen, cp->duplicates);
+	numfound = cp->count;
+	numaccepted = cp->numaccepted;
+	numfinished = cp->numfinished;
+	numcapped = cp->numcapped;
+	numnodes = cp->numnodes;
+	start -= chrono::milliseconds(cp->elapsed);
+	if( verbose ) {
+		cout << "resuming from checkpoint " << cp->get_file() << ", " << cp->count << " wordsquares written, ";
+		cout << queue.size() << " of " << numalive << " seedsquares left" << endl;
+	}
+}
+
+/*
+	Write the checkpoint of the search so far, once every square found
+	is written out, so the output and the checkpoint agree.
+	Once the output has failed the last checkpoint is kept instead
+*/
+template<int N>
+void Squares<N>::save_checkpoint(deque<int>& queue, vector<vector<int> >& resume) {
+
+	Checkpoint* cp = checkpoint;
+	long offset = writer->sync();
+	if( writer->get_error() != 0 ) return;
+	cp->seedwords = seedwords;
+	cp->numseeds = squares.size();
+	cp->dictsize = dict->get_size();
+	cp->settings = get_settings();
+	cp->offset = offset;
+	cp->count = numfound;
+	cp->numaccepted = numaccepted;
+	cp->numfinished = numfinished;
+	cp->numcapped = numcapped;
+	cp->numnodes = numnodes;
+	cp->elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+	cp->queue.clear();
+	for(unsigned i=0; i<queue.size(); i++) {
+		Pending p;
+		p.path = resume[queue[i]].empty() ? vector<int>(1, queue[i]) : resume[queue[i]];
+		p.found = seedfound[queue[i]];
+		cp->queue.push_back(p);
+	}
+	cp->seen.clear();
+	seen_solutions.get_all(cp->seen);
+	cp->duplicates = seen_solutions.get_duplicates();
+	cp->write();
+}
+
+/*
+	Split the search of the seedsquares into shards for worker processes,
+	see Coordinator.  A shard is a range of the candidates for the first
+	word placed in a seedsquare.  The ranges are cut so there are about 
+	SHARDS_PER_PROC shards per worker over all seedsquares, 
+	at least one candidate each, and a seedsquare's shards are in order,
+	so --ordered merges the squares in single threaded order.
+	
+	Workers keep no limits and drop no duplicates, as they only see
+	their own shards.  Both are applied as the shards are merged here,
+	and the search stops when a limit is reached
+*/
+template<int N>
+void Squares<N>::search_shards(vector<Domains<N> >& seeddoms, vector<bool>& alive) {
+
+	int numseeds = squares.size();
+	vector<int> numfirst(numseeds, 0);
+	long total = 0;
+	for(int i=0; i<numseeds; i++) {
+		if( !alive[i] ) continue;
+		Square<N> sqr = squares[i];
+		int index = choose_index(&sqr);
+		if( index == 2*N ) numfirst[i] = 1;
+		else {
+			int seed = sqr.get_pending() != 0 ? choose_seed(&sqr, &seeddoms[i], index) : -1;
+			if( seed >= 0 ) numfirst[i] = 2*N * (firstform[seed+1] - firstform[seed]);
+			else numfirst[i] = count_candidates( sqr.get_constraint_key(index) ) + (sqr.get_pending() != 0 ? forms.size() : 0);
+		}
+		total += numfirst[i];
+	}
+	long size = max( 1L, total / (numprocs * SHARDS_PER_PROC) );
+
+	Coordinator coord(numprocs, worker_mem, ordered);
+	seedshards.assign(numseeds, 0);
+	for(int i=0; i<numseeds; i++) {
+		if( alive[i] && numfirst[i] == 0 ) numfinished++;
+		for(long lo=0; lo<numfirst[i]; lo+=size) {
+			coord.add( i, lo, min(lo+size, (long)numfirst[i]) );
+			seedshards[i]++;
+		}
+	}
+	if( verbose ) {
+		cout << "searching " << coord.get_numshards() << " shards on " << numprocs << " worker processes" << endl;
+	}
+
+	coord.run(
+		[this, &seeddoms](Shard& s, int fd) { return search_shard(s, fd, seeddoms); },
+		[this](Shard& s, vector<string>& grids) { merge_shard(s, grids); },
+		[this]() {
+			if( deadline > 0 && chrono::steady_clock::now() - start >= chrono::milliseconds(deadline) ) {
+				halt("deadline reached");
+			}
+			if( writer->get_error() != 0 ) halt("write failed");
+			return stopped();
+		} );
+
+	numnodes += coord.get_numnodes();
+	if( coord.get_numfailed() > 0 ) halt( to_string(coord.get_numfailed()) + " shards failed" );
+	if( verbose && coord.get_numrestarts() > 0 ) {
+		cout << "replaced " << coord.get_numrestarts() << " worker processes" << endl;
+	}
+}
+
+/*
+	Search a shard in a worker process, writing its squares to fd
+	in the grid format of the Writer.  Return the nodes searched
+*/
+template<int N>
+long Squares<N>::search_shard(Shard& s, int fd, vector<Domains<N> >& seeddoms) {
+	dedupe = false;
+	max_solutions = 0;
+	deadline = 0;
+	max_per_seed = 0;
+	Writer out(fd, "grid", N);
+	writer = &out;
+	Worker<N> worker;
+	worker.id = 0;
+	init_worker(&worker);
+	worker.path.assign(1, s.seed);
+	worker.lo = s.lo;
+	worker.hi = s.hi;
+	Square<N> sqr = squares[s.seed];
+	Domains<N> dom = seeddoms[s.seed];
+	gen_ws(&sqr, &dom, &worker, 0);
+	out.close();
+	writer = NULL;
+	return worker.nodes;
+}
+
+/*
+	Write the squares a worker found in a shard, 
+	dropping duplicates and applying the limits, as found_square does
+*/
+template<int N>
+void Squares<N>::merge_shard(Shard& s, vector<string>& grids) {
+	Square<N> sqr;
+	char word[N];
+	for(unsigned i=0; i<grids.size(); i++) {
+		if( grids[i].size() != N*N ) continue;
+		const char* grid = grids[i].c_str();
+		if( dedupe ) {
+			for(int k=0; k<2*N; k++) {
+				for(int j=0; j<N; j++) word[j] = k < N ? grid[k*N+j] : grid[j*N+k-N];
+				sqr.assign(word, k);
+			}
+			if( !seen_solutions.insert( sqr.canonical_key() ) ) continue;
+		}
+		if( !accept(s.seed) ) continue;
+		writer->push(grid, tag);
+		numfound++;
+	}
+	// a seedsquare is finished when all its shards are, none given up on or cut short
+	if( s.tries >= SHARD_TRIES ) seedshards[s.seed] = -1;
+	else if( !stopped() && --seedshards[s.seed] == 0 ) numfinished++;
+}
+
+// add a worker's node count and nogood table counts to the totals
+template<int N>
+void Squares<N>::add_counts(Worker<N>* w) {
+	numnodes += w->nodes;
+	nogood_counts.probes += w->nogood.probes;
+	nogood_counts.hits += w->nogood.hits;
+	nogood_counts.stores += w->nogood.stores;
+	nogood_counts.evictions += w->nogood.evictions;
+}
+
+// search the subtree of a task, called by the scheduler on a worker thread
+template<int N>
+void Squares<N>::run_task(Task<N>& task, Worker<N>* w) {
+	w->path.assign(task.path, task.path + task.length);
+	STAT( Stats::mark(&w->counters, w->mark); )
+	if( trie != NULL ) start_rows(&task.sqr, w, task.depth);
+	else gen_ws(&task.sqr, &task.dom, w, task.depth);
+	STAT( if( stats ) stats->add_seed(task.path[0], &w->counters, w->mark); )
+}
+
+/*
+	In ordered mode, sort the squares found by every worker by search path,
+	which gives the order a single threaded search would have found them in,
+	and pass them to the writer
+*/
+template<int N>
+void Squares<N>::merge_found(Scheduler<N>* s) {
+
+	if( !ordered ) return;
+
+	vector<pair<vector<int>, Square<N>*> > all;
+	for(int i=0; i<s->get_numworkers(); i++) {
+		Worker<N>* w = s->get_worker(i);
+		for(unsigned j=0; j<w->found.size(); j++) {
+			all.push_back( make_pair(w->found_paths[j], &w->found[j]) );
+		}
+	}
+	sort( all.begin(), all.end(), 
+		[](const pair<vector<int>, Square<N>*>& a, const pair<vector<int>, Square<N>*>& b) {
+			return a.first < b.first; 
+		} );
+	for(unsigned i=0; i<all.size(); i++) {
+		if( dedupe && !seen_solutions.insert( all[i].second->canonical_key() ) ) continue;
+		if( !accept(all[i].first[0]) ) continue;
+		writer->push( all[i].second->get_grid(), tag );
+		numfound++;
+	}
+}
+
+/*
+	Record a solved square.  Stream it to the writer, 
+	or keep it with its path when the parallel search is ordered.
+	With dedupe, a square equal to one already written, or to its 
+	transpose, is dropped.  In ordered mode that check waits for the merge, 
+	so the first square in search order is the one kept.
+	Only handing the square on, to the writer or the ordered merge,
+	is left out of the allocation count, the dedupe set is counted
+*/
+template<int N>
+void Squares<N>::found_square(Square<N>* p_sqr, Worker<N>* w) {
+	if( ordered && scheduler != NULL ) {
+		ALLOC( AllocPause pause; )
+		w->found.push_back(*p_sqr);
+		w->found_paths.push_back(w->path);
+		return;
+	}
+	if( dedupe && !seen_solutions.insert( p_sqr->canonical_key() ) ) return;
+	if( top > 0 ) {
+		rank_square(p_sqr);
+		return;
+	}
+	if( !accept(w->path[0]) ) return;
+	{
+		ALLOC( AllocPause pause; )
+		writer->push( p_sqr->get_grid(), tag );
+	}
+	numfound++;
+}
+
+/*
+	Count a square of a seedsquare against the limits, 
+	return whether it may be written.
+	The square reaching a limit is written, and stops the search
+	of its seedsquare, or of everything
+*/
+template<int N>
+bool Squares<N>::accept(int seed) {
+	if( max_per_seed > 0 ) {
+		long n = ++seedfound[seed];
+		if( n > max_per_seed ) return false;
+		if( n == max_per_seed ) numcapped++;
+	}
+	if( max_solutions > 0 ) {
+		long n = ++numaccepted;
+		if( n > max_solutions ) return false;
+		if( n == max_solutions ) halt("max-solutions reached");
+	}
+	return true;
+}
+
 /*
 	Generate all possible seedsquares using the seed words.
 	
-	If all seedwords are in the square, push it to the vector of squares.
+	If all seedwords are in the square, push it to the vector of squares,
+	unless it or its transpose is already there.
 	Otherwise, get the next seedword.  
 	Try placing the seedword in every available word position.
-	Mark the position as assigned.
-	If the position fits, recurse to the next seedword, then unassign
+	If the seedword fits the crossing words already placed,
+	mark the position as assigned, recurse to the next seedword, then unassign
+
+	Only the seedwords marked placed are, each at every one of its forms.
+	The seedsquares that differ only in where the others go are then 
+	one seedsquare, whose search places the others, marked pending, 
+	as it fills the square, see gen_ws.  That's every seedword shorter
+	than N, and with a seed tree every seedword after the first
 */
-void Squares::gen_ss(Square* sqr, int count) {
+template<int N>
+void Squares<N>::gen_ss(Square<N>* sqr, int count) {
 	
 	if( count == seedsize ) {
+		if( !seen_seeds.insert( sqr->canonical_key() ).second ) {
+			dup_seeds++;
+			return;
+		}
 		squares.push_back( *sqr );
+		squares.back().set_pending( ((1u << seedsize) - 1) & ~placed );
 		return;
 	}
 
-	string word = seedwords[count];
+	if( !(placed & (1u << count)) ) {
+		gen_ss( sqr, count+1 );
+		return;
+	}
+	bool firstplaced = (placed & ((1u << count) - 1)) == 0;
 
-	for(int i=0; i<2*WORDLEN; i++) {
-		if( count==0 && i>= WORDLEN ) break; // skip diagonal reflections
-		if( sqr->empty_at(i) ) {
-			sqr->assign(word, i);
-			if( sqr->test_layout() ) {
+	for(int f=firstform[count]; f<firstform[count+1]; f++) {
+		const char* word = forms[f].c_str();
+		for(int i=0; i<2*N; i++) {
+			if( firstplaced && i>= N ) break; // skip diagonal reflections
+			if( sqr->empty_at(i) && sqr->fits(word, i) ) {
+				sqr->assign(word, i);
 				gen_ss( sqr, count+1 );
+				sqr->unassign(i);
 			}
-			sqr->unassign(i);
 		}
 	}
 
@@ -138,62 +741,1060 @@ void Squares::gen_ss(Square* sqr, int count) {
 /*
 	Generate all possible wordsquares from the seedwords and the wordlist.
 	
-	First get the index of where the next word goes.  
-	If it's equal to 2*WORDLEN, then push the square onto the solution square vector
+	First get the index of where the next word goes, see choose_index.
+	If it's equal to 2*N, the square is solved, see found_square
 	
-	Otherwise, get the regex constraint on the given index.
-	Use the regex to find it's index in the regex wordlist,
-	then use the regex index to get the row numbers of all words that match the regex.
+	Otherwise, get the regex constraint on the given index as a packed key.
+	Use the key to get the row numbers of all words that match the regex.
 	Iterate over each row number, and use the dict to find the actual word.
+	Nothing is allocated, the row numbers are read in place,
+	or with the bitset engine written to the worker's buffer for this depth.
 	
-	Assign each word to the square, then recurse, followed by an unassign
+	Assign each word to the square, then recurse, followed by an unassign.
+	When running in parallel and above split_depth, 
+	push the assigned square as a task instead of recursing,
+	so idle workers can steal it.
+
+	With forward checking, words that don't fit the letter domains are skipped,
+	and after each assignment the domains of the crossing words are narrowed.
+	If a crossing word has no candidate left, the branch is dead
+	and the search moves on without recursing.
+	The domains are restored from a copy before the next word is tried.
+
+	With --top, a partial square is dropped once the most its words 
+	could weigh, see score_bound, is no more than the score of the 
+	lowest of the best squares kept, and so is a word whose weight
+	leaves the bound no higher.
+
+	With a nogood table, a partial square already searched without
+	finding a square is skipped, and one that finds none is added,
+	unless its search was cut short or only partly done here,
+	on a replayed path, in a shard, or split into tasks
+
+	The seedwords still pending, see gen_ss, are candidates too,
+	after the words of the wordlist, at the positions where they fit.
+	Candidate i past the words is form i-numwords, see make_forms, 
+	which keeps a path of candidate numbers for replays, shards, 
+	and ordered merges.  Or a pending seedword is placed instead, 
+	see choose_seed, and candidate i is each of its forms at each 
+	open position, so its alignments are one branch.  With no seedword
+	in the seedsquare, the first placed only goes across, 
+	as gen_ss skips diagonal reflections.
+	A partial square is dead once a pending seedword fits no open position
 	
 */
-void Squares::gen_ws(Square* p_sqr) {
+template<int N>
+void Squares<N>::gen_ws(Square<N>* p_sqr, Domains<N>* dom, Worker<N>* w, int depth) {
 
-	int index = p_sqr->get_next_index();
+	ALLOC( AllocWatch watch; )
 
-	if( index==2*WORDLEN) {
-		squares.push_back(*p_sqr);
+	// replaying the path of an earlier turn, see search_queue
+	unsigned first = 0;
+	if( !w->resume.empty() ) {
+		if( w->resume.size() > (size_t)depth+1 ) first = w->resume[depth+1];
+		else w->resume.clear();
+	}
+	bool fresh = w->resume.empty();
+	if( fresh ) {
+		if( w->budget == 0 || checkpoint_due ) {
+			w->suspended = true;
+			w->resume = w->path;
+			return;
+		}
+		if( w->budget > 0 ) w->budget--;
+		w->nodes++;
+		STAT( stat_add(w->counters.nodes[depth]); )
+		check_clock(w);
+	}
+	if( p_sqr->get_pending() != 0 && !seeds_fit(p_sqr, dom) ) return;
+	int index = choose_index(p_sqr);
+
+	if( index==2*N) {
+		STAT( stat_add(w->counters.solutions[depth]); )
+		w->solutions++;
+		found_square(p_sqr, w);
 		return;
 	}
 
-	string reg = p_sqr->get_constraint(index);
-	int regindex = regs->get_index(reg);
-	if( regindex == -1 ) return;
-	vector<int> regmatches = matches->get_matches(regindex);
+	uint64 state = 0, check = 0;
+	long solutions = w->solutions;
+	if( nogoods != NULL && fresh ) {
+		state = p_sqr->partial_hash(&check);
+		w->nogood.probes++;
+		if( nogoods->contains(state, check) ) {
+			w->nogood.hits++;
+			return;
+		}
+	}
+
+	uint64 key = p_sqr->get_constraint_key(index);
+
+	// with --top, the most the square can score, found once the best squares are full
+	long limit = LONG_MIN, openmax = 0;
+	bool bounded = false;
+	if( top > 0 && fresh && (long)best.size() == top ) {
+		limit = score_bound(p_sqr);
+		openmax = open_max(p_sqr, index);
+		bounded = true;
+		if( limit <= best.front().score ) return;
+	}
+
+	// place a pending seedword instead, if it has fewer places than the position has words
+	int seed = p_sqr->get_pending() != 0 ? choose_seed(p_sqr, dom, index) : -1;
+
+	bool missed = false;
+	Span regmatches;
+	if( seed < 0 ) regmatches = get_candidates(key, buffer_at(w, depth), &missed);
+	else {
+		regmatches.data = NULL;
+		regmatches.length = 0;
+	}
+	// placing a seedword, its candidates are its places, never none as the seedwords fit,
+	// otherwise the words and the forms of pending seedwords that fit index
+	STAT( long numstat = seed >= 0 ? count_places(p_sqr, dom, seed) : regmatches.size(); )
+	STAT( if( seed < 0 && p_sqr->get_pending() != 0 ) numstat += count_pending(p_sqr, index); )
+	STAT( if( missed ) stat_add(w->counters.misses[depth]); )
+	STAT( else if( numstat == 0 ) stat_add(w->counters.empty[depth]); )
+	STAT( stat_add(w->counters.lengths[depth][ stat_bucket(numstat) ]); )
+	bool split = scheduler != NULL && depth < split_depth;
+	Domains<N> saved = *dom;
+
+	// a shard searches a range of the first level
+	unsigned numwords = regmatches.size();
+	unsigned pending = p_sqr->get_pending();
+	unsigned numforms = seed >= 0 ? firstform[seed+1] - firstform[seed] : forms.size();
+	unsigned numcands = seed >= 0 ? 2*N*numforms : numwords + (pending != 0 ? numforms : 0);
+	unsigned end = numcands;
+	if( depth == 0 && w->hi >= 0 ) {
+		first = max(first, (unsigned)w->lo);
+		end = min(end, (unsigned)w->hi);
+	}
 	
-	for(unsigned i=0; i<regmatches.size(); i++) {
-		p_sqr->assign( dict->get_word(regmatches[i]), index );
-		gen_ws(p_sqr);
-		p_sqr->unassign(index);
+	for(unsigned i=first; i<end; i++) {
+		if( halted_for(w) ) break;
+		const char* word;
+		int pos = index;
+		int form = -1;
+		if( seed >= 0 ) {
+			pos = i / numforms;
+			form = firstform[seed] + i % numforms;
+			if( depth == 0 && placed == 0 && pos >= N ) break;
+			if( !p_sqr->empty_at(pos) || !form_fits(p_sqr, dom, form, pos) ) continue;
+			word = forms[form].c_str();
+		} else if( i < numwords ) {
+			word = dict->get_chars(regmatches[i]);
+			if( forward_check && !fits_domains(p_sqr, dom, word, index) ) continue;
+		} else {
+			form = i - numwords;
+			if( !form_fits(p_sqr, dom, form, index) ) continue;
+			word = forms[form].c_str();
+		}
+		if( top > 0 && w->resume.empty() && (long)best.size() == top ) {
+			if( !bounded ) {
+				limit = score_bound(p_sqr);
+				openmax = open_max(p_sqr, index);
+				bounded = true;
+			}
+			if( limit <= best.front().score ) break;
+			if( seed < 0 && i < numwords && limit - openmax + dict->get_weight(regmatches[i]) <= best.front().score ) continue;
+		}
+		p_sqr->assign( word, pos );
+		if( form >= 0 ) p_sqr->set_pending( pending & ~(1u << formseed[form]) );
+		w->path.push_back(i);
+		if( !forward_check || assign_domains(p_sqr, dom, pos, buffer_at(w, 2*N)) ) {
+			bool pushed = false;
+			if( split ) {
+				Task<N> task;
+				task.sqr = *p_sqr;
+				task.dom = *dom;
+				task.set_path(w->path);
+				task.depth = depth+1;
+				pushed = scheduler->push(w, task);
+			}
+			if( !pushed ) gen_ws(p_sqr, dom, w, depth+1);
+		}
+		w->path.pop_back();
+		*dom = saved;
+		p_sqr->unassign(pos);
+		p_sqr->set_pending(pending);
+	}
+
+	if( state != 0 && w->solutions == solutions && first == 0 && end == numcands
+		&& !split && !halted_for(w) ) {
+		w->nogood.stores++;
+		if( nogoods->insert(state, check) ) w->nogood.evictions++;
 	}
 	
 	return;
 }
 
+/*
+	The most the words of a square can weigh once it's complete,
+	the sum over every word position of the largest weight of the words
+	that fit it, see Matches::set_weights.  An assigned word is the only
+	word that fits its position, so a complete square's bound is its score.
+	A seedword that isn't in the wordlist weighs 0.
+	LONG_MIN if some open position has no word that fits
+*/
+template<int N>
+long Squares<N>::score_bound(Square<N>* p_sqr) {
+	long bound = 0;
+	for(int i=0; i<2*N; i++) {
+		long most = p_sqr->empty_at(i) ? open_max(p_sqr, i) : pattern_max( p_sqr->get_constraint_key(i) );
+		if( most == LONG_MIN && p_sqr->empty_at(i) ) return LONG_MIN;
+		if( most != LONG_MIN ) bound += most;
+	}
+	return bound;
+}
+
+/*
+	the most a word at an open position can weigh, the largest weight
+	of the words that fit, or 0 if a pending seedword may go there
+	and outweighs them, as it may not be in the wordlist
+*/
+template<int N>
+long Squares<N>::open_max(Square<N>* p_sqr, int index) {
+	long most = pattern_max( p_sqr->get_constraint_key(index) );
+	if( p_sqr->get_pending() != 0 && most < 0 && count_pending(p_sqr, index) > 0 ) most = 0;
+	return most;
+}
+
+// the largest weight of the words matching the regex with the given key, LONG_MIN if none
+template<int N>
+long Squares<N>::pattern_max(uint64 key) {
+	if( key == 0 ) return dict->get_maxweight();
+	int regindex = regs->get_index(key);
+	if( regindex == -1 ) return LONG_MIN;
+	return matches->get_maxweight(regindex);
+}
+
+/*
+	Keep a complete square if it's among the top best found so far.
+	best is a heap with the lowest ranked square in front, so a full 
+	heap drops that one for a square scoring higher
+*/
+template<int N>
+void Squares<N>::rank_square(Square<N>* p_sqr) {
+	auto higher = [](const Ranked& a, const Ranked& b) {
+		return a.score > b.score || (a.score == b.score && a.seq < b.seq);
+	};
+	Ranked r;
+	r.score = score_bound(p_sqr);
+	r.seq = numranked++;
+	r.sqr = *p_sqr;
+	if( (long)best.size() == top ) {
+		if( r.score <= best.front().score ) return;
+		pop_heap( best.begin(), best.end(), higher );
+		best.pop_back();
+	}
+	best.push_back(r);
+	push_heap( best.begin(), best.end(), higher );
+}
+
+// write the squares kept by --top, the highest score first
+template<int N>
+void Squares<N>::write_top() {
+	sort( best.begin(), best.end(), [](const Ranked& a, const Ranked& b) {
+		return a.score > b.score || (a.score == b.score && a.seq < b.seq);
+	} );
+	writer->set_scored();
+	for(unsigned i=0; i<best.size(); i++) {
+		writer->push( best[i].sqr.get_grid(), tag, best[i].score );
+		numfound++;
+	}
+}
+
+/*
+	Choose the open word position to fill next, 2*N if the square is full.
+	
+	With static order, it's the first open position.
+	With dynamic order, it's the open position whose regex matches the fewest words,
+	read from the length of its column in the matches matrix,
+	counting the pending seedwords that fit it.
+	Ties go to the position crossing the most open positions.
+	A position with no matching words is returned right away, the branch is dead
+*/
+template<int N>
+int Squares<N>::choose_index(Square<N>* p_sqr) {
+
+	if( !dynamic_order ) return p_sqr->get_next_index();
+
+	int best = 2*N, bestcount = 0, bestcross = 0;
+	for(int i=0; i<2*N; i++) {
+		if( !p_sqr->empty_at(i) ) continue;
+		int count = count_candidates( p_sqr->get_constraint_key(i) );
+		if( p_sqr->get_pending() != 0 ) count += count_pending(p_sqr, i);
+		if( count == 0 ) return i;
+		int cross = 0;
+		for(int j=0; j<2*N; j++) {
+			if( p_sqr->empty_at(j) && p_sqr->crosses(i, j) ) cross++;
+		}
+		if( best == 2*N || count < bestcount || (count == bestcount && cross > bestcross) ) {
+			best = i;
+			bestcount = count;
+			bestcross = cross;
+		}
+	}
+	return best;
+}
+
+/*
+	Set up the letter domains of every seedsquare, and mark the ones
+	with no possible solution as not alive.
+	With root arc consistency, report how many seedsquares were rejected,
+	and how many candidates the open word positions of the others have
+	before and after the domains were narrowed.
+
+	The row filling search of the trie engine uses no domains.
+	Instead each seedsquare is searched in whichever orientation,
+	as it is or transposed, puts its letters in the first rows to fill,
+	see row_score.  Squares found in a transposed seedsquare are flipped back
+*/
+template<int N>
+void Squares<N>::prepare_seedsquares(vector<Domains<N> >& doms, vector<bool>& alive) {
+
+	int numseeds = squares.size();
+	doms = vector<Domains<N> >(numseeds);
+	alive = vector<bool>(numseeds);
+	if( trie != NULL ) {
+		alive.assign(numseeds, true);
+		flipped.assign(numseeds, false);
+		for(int i=0; i<numseeds; i++) {
+			Square<N> t = squares[i].transpose();
+			if( row_score(t) > row_score(squares[i]) ) {
+				squares[i] = t;
+				flipped[i] = true;
+			}
+		}
+		return;
+	}
+
+	int rejected = 0;
+	long before = 0, after = 0;
+	Square<N> sqr;
+	vector<int> buffer( bitsets != NULL ? dict->get_size() : 0 );
+	for(int i=0; i<numseeds; i++) {
+		sqr = squares[i];
+		alive[i] = init_domains(&sqr, &doms[i], buffer.data());
+		if( !alive[i] ) {
+			rejected++;
+			continue;
+		}
+		if( !(forward_check && root_ac) ) continue;
+		for(int j=0; j<2*N; j++) {
+			if( !sqr.empty_at(j) || sqr.get_constraint_key(j) == 0 ) continue;
+			before += count_candidates( sqr.get_constraint_key(j) );
+			after += revise(&sqr, &doms[i], j, buffer.data());
+		}
+	}
+
+	if( !verbose ) return;
+	if( forward_check ) {
+		cout << "rejected " << rejected << " of " << numseeds << " seedsquares without search" << endl;
+	}
+	if( forward_check && root_ac && rejected < numseeds ) {
+		cout << "arc consistency narrowed the remaining seedsquares from " << before;
+		cout << " to " << after << " candidates over all open word positions" << endl;
+	}
+}
+
+/*
+	Set up the letter domains of a seedsquare.
+	Cells of assigned words hold just their letter, every other cell
+	may hold any character.  Then narrow every open word that crosses
+	an assigned word, or with root arc consistency every open word
+	until nothing changes.  Return false if one of them has no candidate left,
+	the seedsquare has no solution
+*/
+template<int N>
+bool Squares<N>::init_domains(Square<N>* p_sqr, Domains<N>* dom, int* buf) {
+	for(int r=0; r<N; r++) {
+		for(int c=0; c<N; c++) {
+			dom->cell[r][c] = ALLCHARS;
+		}
+	}
+	if( !forward_check ) return true;
+
+	for(int i=0; i<2*N; i++) {
+		if( !p_sqr->empty_at(i) ) {
+			for(int p=0; p<N; p++) {
+				p_sqr->domain_at(dom, i, p) = char_bit( p_sqr->get_char(i, p) );
+			}
+		}
+	}
+	if( root_ac ) {
+		return arc_consistency(p_sqr, dom, buf);
+	}
+	for(int i=0; i<2*N; i++) {
+		if( !p_sqr->empty_at(i) ) continue;
+		for(int j=0; j<2*N; j++) {
+			if( !p_sqr->empty_at(j) && p_sqr->crosses(i, j) ) {
+				if( !revise(p_sqr, dom, i, buf) ) return false;
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+	AC-3 over the open word positions of a square.
+	Revise every open position with at least one narrowed cell, 
+	and whenever a revision narrows the domain of a cell, 
+	revise the open position crossing that cell again.
+	Positions whose cells are all unconstrained are left until then,
+	revising them would read the whole wordlist for almost no gain.
+	Stop when no domain changes, or return false as soon as 
+	some position has no candidate left
+*/
+template<int N>
+bool Squares<N>::arc_consistency(Square<N>* p_sqr, Domains<N>* dom, int* buf) {
+
+	bool queued[2*N];
+	deque<int> queue;
+	for(int i=0; i<2*N; i++) {
+		queued[i] = false;
+		if( !p_sqr->empty_at(i) ) continue;
+		for(int p=0; p<N; p++) {
+			if( p_sqr->domain_at(dom, i, p) != ALLCHARS ) queued[i] = true;
+		}
+		if( queued[i] ) queue.push_back(i);
+	}
+
+	unsigned old[N];
+	while( !queue.empty() ) {
+		int index = queue.front();
+		queue.pop_front();
+		queued[index] = false;
+
+		for(int p=0; p<N; p++) {
+			old[p] = p_sqr->domain_at(dom, index, p);
+		}
+		if( !revise(p_sqr, dom, index, buf) ) return false;
+
+		// the position crossing cell p is column p for a row, row p for a column
+		for(int p=0; p<N; p++) {
+			if( p_sqr->domain_at(dom, index, p) == old[p] ) continue;
+			int other = index < N ? p+N : p;
+			if( p_sqr->empty_at(other) && !queued[other] ) {
+				queued[other] = true;
+				queue.push_back(other);
+			}
+		}
+	}
+	return true;
+}
+
+/*
+	Forward check after a word has been assigned at index.
+	The word's cells now hold just its letters.
+	Narrow the domains of every open word crossing it,
+	return false if one of them has no candidate left
+*/
+template<int N>
+bool Squares<N>::assign_domains(Square<N>* p_sqr, Domains<N>* dom, int index, int* buf) {
+	for(int p=0; p<N; p++) {
+		p_sqr->domain_at(dom, index, p) = char_bit( p_sqr->get_char(index, p) );
+	}
+	for(int i=0; i<2*N; i++) {
+		if( p_sqr->empty_at(i) && p_sqr->crosses(i, index) ) {
+			if( !revise(p_sqr, dom, i, buf) ) return false;
+		}
+	}
+	return true;
+}
+
+/*
+	Narrow the domains of the cells of the open word at index
+	to the letters used by its remaining candidates, 
+	the words that fit its regex and the domains of all its cells,
+	and the pending seedwords that fit it.
+	buf is for the candidates of the bitset engine, see get_candidates.
+	Return the number of candidates left, 0 if the branch is dead
+*/
+template<int N>
+int Squares<N>::revise(Square<N>* p_sqr, Domains<N>* dom, int index, int* buf) {
+	Span regmatches = get_candidates( p_sqr->get_constraint_key(index), buf );
+
+	unsigned support[N] = {0};
+	int left = 0;
+	for(unsigned i=0; i<regmatches.size(); i++) {
+		const char* word = dict->get_chars(regmatches[i]);
+		if( !fits_domains(p_sqr, dom, word, index) ) continue;
+		for(int p=0; p<N; p++) {
+			support[p] |= char_bit(word[p]);
+		}
+		left++;
+	}
+	for(unsigned f=0; p_sqr->get_pending() != 0 && f<forms.size(); f++) {
+		if( !form_fits(p_sqr, dom, f, index) ) continue;
+		for(int p=0; p<N; p++) {
+			support[p] |= char_bit(forms[f][p]);
+		}
+		left++;
+	}
+	if( left == 0 ) return 0;
+
+	for(int p=0; p<N; p++) {
+		p_sqr->domain_at(dom, index, p) &= support[p];
+	}
+	return left;
+}
+
+// test if every letter of a word is in the domain of its cell at index
+template<int N>
+bool Squares<N>::fits_domains(Square<N>* p_sqr, Domains<N>* dom, const char* word, int index) {
+	for(int p=0; p<N; p++) {
+		if( !(p_sqr->domain_at(dom, index, p) & char_bit(word[p])) ) return false;
+	}
+	return true;
+}
+
+/*
+	test if form f of a pending seedword can go at the open position index,
+	it fits the letters there, and the domains with forward checking
+*/
+template<int N>
+bool Squares<N>::form_fits(Square<N>* p_sqr, Domains<N>* dom, int f, int index) {
+	if( !(p_sqr->get_pending() & (1u << formseed[f])) ) return false;
+	const char* word = forms[f].c_str();
+	if( !p_sqr->fits(word, index) ) return false;
+	return !forward_check || fits_domains(p_sqr, dom, word, index);
+}
+
+// test if pending seedword k can go at the open position index, in any of its forms
+template<int N>
+bool Squares<N>::pending_fits(Square<N>* p_sqr, Domains<N>* dom, int k, int index) {
+	for(int f=firstform[k]; f<firstform[k+1]; f++) {
+		if( form_fits(p_sqr, dom, f, index) ) return true;
+	}
+	return false;
+}
+
+// return the number of forms of pending seedwords that fit the letters of the open position index
+template<int N>
+int Squares<N>::count_pending(Square<N>* p_sqr, int index) {
+	int count = 0;
+	for(unsigned f=0; f<forms.size(); f++) {
+		if( (p_sqr->get_pending() & (1u << formseed[f])) && p_sqr->fits(forms[f].c_str(), index) ) count++;
+	}
+	return count;
+}
+
+// return the number of places of pending seedword k, its forms that fit open positions
+template<int N>
+int Squares<N>::count_places(Square<N>* p_sqr, Domains<N>* dom, int k) {
+	int places = 0;
+	for(int i=0; i<2*N; i++) {
+		if( !p_sqr->empty_at(i) ) continue;
+		for(int f=firstform[k]; f<firstform[k+1]; f++) {
+			if( form_fits(p_sqr, dom, f, i) ) places++;
+		}
+	}
+	return places;
+}
+
+/*
+	Choose a pending seedword to place next rather than fill the open
+	position index: the one with the fewest places, forms at open
+	positions, if that's no more than the candidates of index.  -1 for none
+*/
+template<int N>
+int Squares<N>::choose_seed(Square<N>* p_sqr, Domains<N>* dom, int index) {
+	int most = count_candidates( p_sqr->get_constraint_key(index) ) + count_pending(p_sqr, index);
+	int seed = -1;
+	for(int k=0; k<seedsize; k++) {
+		if( !(p_sqr->get_pending() & (1u << k)) ) continue;
+		int places = count_places(p_sqr, dom, k);
+		if( places <= most ) {
+			seed = k;
+			most = places;
+		}
+	}
+	return seed;
+}
+
+/*
+	test if the pending seedwords can still all be placed:
+	there are as many open positions, and each one fits at least one
+*/
+template<int N>
+bool Squares<N>::seeds_fit(Square<N>* p_sqr, Domains<N>* dom) {
+	int open = 0, left = 0;
+	for(int i=0; i<2*N; i++) {
+		if( p_sqr->empty_at(i) ) open++;
+	}
+	for(int k=0; k<seedsize; k++) {
+		if( !(p_sqr->get_pending() & (1u << k)) ) continue;
+		if( ++left > open ) return false;
+		int i = 0;
+		while( i<2*N && !(p_sqr->empty_at(i) && pending_fits(p_sqr, dom, k, i)) ) i++;
+		if( i == 2*N ) return false;
+	}
+	return true;
+}
+
+/*
+	Return the row numbers of all words that match the regex with the given key.
+	With the bitset engine, intersect the bitsets of the fixed positions.
+	Otherwise use the key to find the regex's index in the regex wordlist,
+	then read the regex's column of the matches matrix.
+
+	A regex of all wildcards, key 0, has no column, and matches every word.
+	Only an open word position crossing no assigned word has that regex.
+	missed, if given, is set when the regex isn't in Regs at all.
+
+	Nothing is copied, the span points into the matches matrix or the Dict,
+	or with the bitset engine into buf, which has room for every word.
+	It's valid until buf is used again
+*/
+template<int N>
+Span Squares<N>::get_candidates(uint64 key, int* buf, bool* missed) {
+	Span span;
+	span.data = NULL;
+	span.length = 0;
+	if( key == 0 ) {
+		span.data = dict->get_all();
+		span.length = dict->get_size();
+		return span;
+	}
+	if( bitsets != NULL ) {
+		span.data = buf;
+		span.length = bitsets->get_matches(key, buf);
+		return span;
+	}
+	int regindex = regs->get_index(key);
+	if( regindex == -1 ) {
+		if( missed != NULL ) *missed = true;
+		return span;
+	}
+	return matches->get_matches(regindex);
+}
+
+/*
+	Set up a worker before it searches, so the search allocates nothing.
+	The path has room for every level, and with the bitset engine
+	the buffer has room for a candidate list at each depth, 
+	plus one for revise
+*/
+template<int N>
+void Squares<N>::init_worker(Worker<N>* w) {
+	w->path.reserve(2*N+1);
+	if( bitsets != NULL ) w->buffer.resize( (long)(2*N+1) * dict->get_size() );
+}
+
+/*
+	Return the worker's buffer for the candidates at depth, 2*N for revise,
+	NULL without the bitset engine, which doesn't need one
+*/
+template<int N>
+int* Squares<N>::buffer_at(Worker<N>* w, int slot) {
+	if( bitsets == NULL ) return NULL;
+	return &w->buffer[ (long)slot * dict->get_size() ];
+}
+
+// return the number of words that match the regex with the given key
+template<int N>
+int Squares<N>::count_candidates(uint64 key) {
+	if( key == 0 ) {
+		return dict->get_size();
+	}
+	if( bitsets != NULL ) {
+		return bitsets->count(key);
+	}
+	int regindex = regs->get_index(key);
+	if( regindex == -1 ) return 0;
+	return matches->count(regindex);
+}
+
+/*
+	Start the row filling search of a square with the trie engine.
+	Every column without a word starts at the root of the trie,
+	a column holding a seedword is fixed and needs no prefix.
+	gen_rows walks the columns through the rows already filled
+*/
+template<int N>
+void Squares<N>::start_rows(Square<N>* p_sqr, Worker<N>* w, int depth) {
+	int cols[N];
+	for(int c=0; c<N; c++) {
+		cols[c] = p_sqr->empty_at(N+c) ? trie->get_root() : -1;
+	}
+	gen_rows(p_sqr, cols, 0, w, depth);
+}
+
+/*
+	Row filling search with the trie engine.
+	Rows are filled top to bottom.  cols holds the trie node of the
+	prefix of every open column over the rows above, -1 for a fixed column.
+
+	A row that already holds a word, a seedword or a row filled before 
+	the square became a task, only moves the columns down a level,
+	and the branch is dead if one of them has no child for its letter.
+	Otherwise every word that fits the row is found by fill_row,
+	walking the trie for the row and the columns' tries together
+*/
+template<int N>
+void Squares<N>::gen_rows(Square<N>* p_sqr, int* cols, int row, Worker<N>* w, int depth) {
+
+	ALLOC( AllocWatch watch; )
+	w->nodes++;
+	STAT( stat_add(w->counters.nodes[depth]); )
+	check_clock(w);
+	if( row == N ) {
+		STAT( stat_add(w->counters.solutions[depth]); )
+		found_rows(p_sqr, w);
+		return;
+	}
+
+	int next[N];
+	if( !p_sqr->empty_at(row) ) {
+		for(int c=0; c<N; c++) {
+			next[c] = cols[c] < 0 ? -1 : trie->child( cols[c], char_bit(p_sqr->get_char(row, c)) );
+			if( cols[c] >= 0 && next[c] < 0 ) return;
+		}
+		gen_rows(p_sqr, next, row+1, w, depth);
+		return;
+	}
+
+	char word[N];
+	int k = 0;
+	fill_row(p_sqr, cols, row, 0, trie->get_root(), word, next, k, w, depth);
+}
+
+/*
+	Choose the letter at position pos of the row, and recurse to the next position.
+	The letter must continue the row's prefix at node, continue the prefix of
+	its column, and match a letter placed by a seedword in that column.
+	next collects the column nodes one row down.
+	With the whole row chosen, assign it and search the rows below,
+	or push the square as a task above split_depth.
+	k counts the rows tried so far, for the search path
+*/
+template<int N>
+void Squares<N>::fill_row(Square<N>* p_sqr, int* cols, int row, int pos, int node, char* word, int* next, int& k, Worker<N>* w, int depth) {
+
+	if( halted_for(w) ) return;
+
+	if( pos == N ) {
+		p_sqr->assign(word, row);
+		w->path.push_back(k++);
+		bool pushed = false;
+		if( scheduler != NULL && depth < split_depth ) {
+			Task<N> task;
+			task.sqr = *p_sqr;
+			task.set_path(w->path);
+			task.depth = depth+1;
+			pushed = scheduler->push(w, task);
+		}
+		if( !pushed ) gen_rows(p_sqr, next, row+1, w, depth+1);
+		w->path.pop_back();
+		p_sqr->unassign(row);
+		return;
+	}
+
+	unsigned allowed = trie->get_mask(node);
+	if( cols[pos] >= 0 ) allowed &= trie->get_mask(cols[pos]);
+	char fixed = p_sqr->get_char(row, pos);
+	if( fixed != '*' ) allowed &= char_bit(fixed);
+
+	while( allowed ) {
+		int b = __builtin_ctz(allowed);
+		unsigned bit = 1u << b;
+		allowed &= allowed-1;
+		word[pos] = bit_char(b);
+		next[pos] = cols[pos] >= 0 ? trie->child(cols[pos], bit) : -1;
+		fill_row(p_sqr, cols, row, pos+1, trie->child(node, bit), word, next, k, w, depth);
+	}
+}
+
+/*
+	Every row is filled and every open column spells a word.
+	Assign the columns too, so the square is complete like
+	the squares found by gen_ws, flip it back if its seedsquare 
+	was transposed, the first entry of the path, and record it
+*/
+template<int N>
+void Squares<N>::found_rows(Square<N>* p_sqr, Worker<N>* w) {
+	ALLOC( AllocPause pause; )
+	Square<N> done = *p_sqr;
+	for(int c=N; c<2*N; c++) {
+		if( done.empty_at(c) ) done.assign( done.get_word(c).c_str(), c );
+	}
+	if( flipped[ w->path[0] ] ) done = done.transpose();
+	found_square(&done, w);
+}
+
+/*
+	Score how early the row filling search meets the letters of a seedsquare.
+	A row holding a word fixes every column's prefix, an open row
+	has its letters from seedwords in columns, and earlier rows count more
+*/
+template<int N>
+int Squares<N>::row_score(Square<N>& sqr) {
+	int score = 0;
+	for(int r=0; r<N; r++) {
+		int fixed = 0;
+		for(int c=0; c<N; c++) {
+			if( sqr.get_char(r, c) != '*' ) fixed++;
+		}
+		score += fixed * (N-r);
+	}
+	return score;
+}
+
 // return the number of squares in the squares vector
-int Squares::get_numsquares() {
+template<int N>
+int Squares<N>::get_numsquares() {
 	return squares.size();
 }
 
 // set the wordlist object
-void Squares::set_dict(Dict *d) {
+template<int N>
+void Squares<N>::set_dict(Dict *d) {
 	dict = d;
 }
 
 // set the precomputed regs object
-void Squares::set_regs(Regs *r) {
+template<int N>
+void Squares<N>::set_regs(Regs *r) {
 	regs=r;
 }
 
 // set the precomputed match matrix
-void Squares::set_matches(Matches *m) {
+template<int N>
+void Squares<N>::set_matches(Matches *m) {
 	matches=m;
 }
 
+// return the number of duplicate solutions dropped so far
+template<int N>
+long Squares<N>::get_numduplicates() {
+	return seen_solutions.get_duplicates();
+}
+
+// return the number of search nodes, partial squares, visited
+template<int N>
+long Squares<N>::get_numnodes() {
+	return numnodes;
+}
+
+// return the number of solved squares found so far
+template<int N>
+long Squares<N>::get_numfound() {
+	return numfound;
+}
+
+// set the bitset engine, used in place of regs and matches
+template<int N>
+void Squares<N>::set_bitsets(Bitsets *b) {
+	bitsets=b;
+}
+
+// set the trie engine, which switches to the row filling search
+template<int N>
+void Squares<N>::set_trie(Trie *t) {
+	trie=t;
+}
+
+/*
+	set a flag that stops the search when it becomes true, 
+	checked at every search node.  Squares already found are kept
+*/
+template<int N>
+void Squares<N>::set_stop(atomic<bool>* s) {
+	stop = s;
+}
+
+// test if the stop flag is set
+template<int N>
+bool Squares<N>::stopped() {
+	if( halted.load(memory_order_relaxed) ) return true;
+	return stop != NULL && stop->load(memory_order_relaxed);
+}
+
+/*
+	test if the search of a worker's seedsquare should stop:
+	the search was stopped, it reached max_per_seed, 
+	or the worker's turn is over
+*/
+template<int N>
+bool Squares<N>::halted_for(Worker<N>* w) {
+	if( stopped() || w->suspended ) return true;
+	return max_per_seed > 0 && seedfound[ w->path[0] ].load(memory_order_relaxed) >= max_per_seed;
+}
+
+/*
+	halt the search once the deadline has passed or the output
+	can't be written, and note when a checkpoint is due.
+	Checked every CLOCK_NODES nodes
+*/
+template<int N>
+void Squares<N>::check_clock(Worker<N>* w) {
+	if( w->nodes % CLOCK_NODES != 0 ) return;
+	if( writer != NULL && writer->get_error() != 0 ) {
+		halt("write failed");
+		return;
+	}
+	if( deadline > 0 && chrono::steady_clock::now() - start >= chrono::milliseconds(deadline) ) {
+		halt("deadline reached");
+	}
+	if( checkpoint != NULL && checkpoint->due() ) checkpoint_due = true;
+}
+
+// stop the search because of a limit, the first reason is the one reported
+template<int N>
+void Squares<N>::halt(string reason) {
+	lock_guard<mutex> guard(haltlock);
+	if( halted ) return;
+	halt_reason = reason;
+	halted = true;
+}
+
+/*
+	return whether the search found every square, "complete", 
+	or what cut it short, "partial" and the reason
+*/
+template<int N>
+string Squares<N>::get_status() {
+	string status;
+	if( halted ) {
+		status = "partial, " + halt_reason;
+	} else if( stop != NULL && *stop ) {
+		status = "partial, stopped";
+	} else if( numcapped > 0 ) {
+		status = "partial, max-per-seed reached on " + to_string(numcapped) + " seedsquares";
+	} else {
+		return "complete";
+	}
+	if( numthreads <= 1 || numprocs > 1 ) {
+		status += ", " + to_string(numfinished) + " of " + to_string(numalive) + " seedsquares finished";
+	}
+	return status;
+}
+
+// set whether search statistics are printed
+template<int N>
+void Squares<N>::set_verbose(bool v) {
+	verbose = v;
+}
+
+// set the tag squares are written with, the batch query they solve
+template<int N>
+void Squares<N>::set_tag(int t) {
+	tag = t;
+}
+
+// set the statistics collector of a WS_STATS build
+template<int N>
+void Squares<N>::set_stats(Stats* s) {
+	stats = s;
+}
+
+/*
+	set the checkpoint the search is saved to, and resumed from if it was read.
+	Only a single threaded search of the regex engines is checkpointed
+*/
+template<int N>
+void Squares<N>::set_checkpoint(Checkpoint* c) {
+	checkpoint = c;
+}
+
+/*
+	return a line on the use of the nogood table: lookups, hits, 
+	partial squares stored and overwritten, and how full the table is
+*/
+template<int N>
+string Squares<N>::get_nogood_stats() {
+	if( nogoods == NULL ) return "no nogood table";
+	NogoodCounts& c = nogood_counts;
+	char rate[32];
+	snprintf(rate, sizeof(rate), "%.1f", c.probes > 0 ? 100.0*c.hits/c.probes : 0.0);
+	return "nogood table: " + to_string(c.probes) + " lookups, " + to_string(c.hits) + " hits (" + rate + "%), "
+		+ to_string(c.stores) + " stored, " + to_string(c.evictions) + " overwritten, "
+		+ to_string(nogoods->get_used()) + " of " + to_string(nogoods->get_numslots()) + " slots used";
+}
+
+// return how many squares were scored, and the scores of the ones kept
+template<int N>
+string Squares<N>::get_top_stats() {
+	if( best.empty() ) return "scored " + to_string(numranked) + " wordsquares";
+	return "scored " + to_string(numranked) + " wordsquares, kept " + to_string(best.size())
+		+ " scoring " + to_string(best.front().score) + " to " + to_string(best.back().score);
+}
+
+/*
+	return the settings that decide which squares are found and in what order,
+	a checkpoint is only resumed with the same ones
+*/
+template<int N>
+string Squares<N>::get_settings() {
+	string s = bitsets != NULL ? "bitset" : trie != NULL ? "trie" : "csc";
+	s += " fc " + to_string(forward_check) + " dynamic " + to_string(dynamic_order);
+	s += " ac " + to_string(root_ac) + " dedupe " + to_string(dedupe);
+	s += " max-solutions " + to_string(max_solutions) + " deadline " + to_string(deadline);
+	s += " max-per-seed " + to_string(max_per_seed);
+	if( seed_tree ) s += " seed-tree";
+	return s;
+}
+
+// apply the search settings of the command line options
+template<int N>
+void Squares<N>::set_options(Options& opts) {
+	numthreads = opts.numthreads;
+	ordered = opts.ordered;
+	forward_check = opts.forward_check;
+	dynamic_order = opts.dynamic_order;
+	root_ac = opts.root_ac;
+	dedupe = opts.dedupe;
+	max_solutions = opts.max_solutions;
+	deadline = opts.deadline;
+	max_per_seed = opts.max_per_seed;
+	numprocs = opts.numprocs;
+	worker_mem = opts.worker_mem;
+	nogood_mb = opts.nogood_mb;
+	top = opts.top;
+	seed_tree = opts.seed_tree;
+}
+
+// set the number of search threads
+template<int N>
+void Squares<N>::set_numthreads(int n) {
+	numthreads = n;
+}
+
+// set whether found squares are merged in single threaded search order
+template<int N>
+void Squares<N>::set_ordered(bool o) {
+	ordered = o;
+}
+
+// set whether the search prunes with letter domains
+template<int N>
+void Squares<N>::set_forward_check(bool f) {
+	forward_check = f;
+}
+
+// set whether the next word position is chosen by fewest matching words
+template<int N>
+void Squares<N>::set_dynamic_order(bool d) {
+	dynamic_order = d;
+}
+
+// set whether seedsquares are made arc consistent before their search
+template<int N>
+void Squares<N>::set_arc_consistency(bool a) {
+	root_ac = a;
+}
+
+// set whether duplicate seedsquares and solutions are dropped
+template<int N>
+void Squares<N>::set_dedupe(bool d) {
+	dedupe = d;
+}
+
 // print all the seedwords
-void Squares::print_seedwords() {
+template<int N>
+void Squares<N>::print_seedwords() {
 	cout << "printing seedwords..."<<endl;
 	for(int i=0; i<seedsize; i++) {
 		cout << i << ": " << seedwords[i] << endl;
@@ -201,13 +1802,11 @@ void Squares::print_seedwords() {
 }
 
 /*
-	print all squares.
-	Since completed squares are written to the end of a vector
-	that also contains seedsquares, both seedsquares and complete squares
-	will be printed, depending on when the method is called.
+	print all seedsquares.
 	not currently called in the program, but here for completeness.
 */
-void Squares::print_squares() {
+template<int N>
+void Squares<N>::print_squares() {
 	cout << "printing squares..." << endl;
 	for(unsigned i=0; i<squares.size(); i++) {
 		cout << i << endl;
@@ -216,31 +1815,15 @@ void Squares::print_squares() {
 	}
 }
 
-// set the output file name
-void Squares::set_outfile_name(string outfilename)  {
-	outfile=outfilename;
-}
-
-/*
-	Write the completed WordSquares to the provided output file
-*/
-void Squares::write_solved_squares() {
-
-	int num_solved_squares = squares.size()-num_seedsquares;
-	
-	ofstream outstream;
-	outstream.open( outfile.c_str() );
-	
-	outstream << "found " << num_solved_squares << " wordsquares" << endl << endl;
-	
-	for(int i=num_seedsquares; i<squares.size(); i++) {
-		outstream << i-num_seedsquares+1 << ": " << endl << endl;
-		Square sqr = squares[i];
-		sqr.write_words(outstream);
-		if(i!=squares.size()-1) outstream << endl << endl;
-	}
-	
-	outstream.close();
-
+// set the writer that solved squares are streamed to
+template<int N>
+void Squares<N>::set_writer(Writer* wr) {
+	writer = wr;
 }
 
+template class Squares<3>;
+template class Squares<4>;
+template class Squares<5>;
+template class Squares<6>;
+template class Squares<7>;
+template class Squares<8>;
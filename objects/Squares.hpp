@@ -4,8 +4,14 @@
 
 	Where the heavy lifting is done for computing WordSquares
 
-	Contains a vector of squares where WordSquare solutions are written.
-	Also contains pointers to preprocessed Dict, Regs, and Matches objects
+	Contains a vector of seed squares, and a Writer that solutions are streamed to.
+	Also contains pointers to preprocessed Dict, Regs, and Matches objects,
+	or to a Bitsets engine that replaces Regs and Matches,
+	or to a Trie for the row filling search
+
+	Templated on the width of the square, N, like Square.
+	Squares.cpp instantiates every width from MINLEN to MAXLEN,
+	and the program picks the one matching the loaded wordlist
 
 	This software is distributed under 
 	the modified Berkeley Software Distribution (BSD) License.
@@ -14,13 +20,29 @@
 #ifndef SQUARES_HPP
 #define SQUARES_HPP
 
+// nodes a seedsquare is searched for in one round robin turn
+#define SLICE_NODES 4096
+
+// shards per worker process in a sharded search
+#define SHARDS_PER_PROC 16
+
+// nodes between checks of the clock, for the deadline and checkpoints
+#define CLOCK_NODES 256
+
+// tasks a worker can queue besides its share of the seedsquares, the rest it searches itself
+#define TASK_SLOTS 1024
+
+template<int N>
 class Squares{
 
 	public:
 		// initializers
 		Squares();
 		Squares(string);
+		Squares(vector<string>&);
+		~Squares();
 		void read_seedfile();
+		static string check_seedwords(vector<string>&);
 
 		// public generator methods
 		void generate_seedsquares();
@@ -30,27 +52,99 @@ class Squares{
 		void set_dict(Dict*);
 		void set_regs(Regs*);
 		void set_matches(Matches*);
+		void set_bitsets(Bitsets*);
+		void set_trie(Trie*);
+		void set_numthreads(int);
+		void set_ordered(bool);
+		void set_forward_check(bool);
+		void set_dynamic_order(bool);
+		void set_arc_consistency(bool);
+		void set_dedupe(bool);
+		void set_options(Options&);
+		void set_stop(atomic<bool>*);
+		void set_verbose(bool);
+		void set_tag(int);
+		void set_stats(Stats*);
+		void set_checkpoint(Checkpoint*);
 
 		// get and print methods
 		int get_numsquares();
+		long get_numfound();
+		long get_numnodes();
+		string get_status();
+		string get_settings();
+		string get_nogood_stats();
+		string get_top_stats();
+		long get_numduplicates();
 		void print_seedwords();
 		void print_squares();
 		
 		// writing methods
-		void set_outfile_name(string);
-		void write_solved_squares();
+		void set_writer(Writer*);
 
 
 	private:
 		// private generator methods 
-		void gen_ss(Square*, int);
-		void gen_ws(Square*);
+		void gen_ss(Square<N>*, int);
+		void gen_ws(Square<N>*, Domains<N>*, Worker<N>*, int);
+		void prepare_seedsquares(vector<Domains<N> >&, vector<bool>&);
+		bool init_domains(Square<N>*, Domains<N>*, int*);
+		bool arc_consistency(Square<N>*, Domains<N>*, int*);
+		bool assign_domains(Square<N>*, Domains<N>*, int, int*);
+		int revise(Square<N>*, Domains<N>*, int, int*);
+		bool fits_domains(Square<N>*, Domains<N>*, const char*, int);
+		void make_forms();
+		bool form_fits(Square<N>*, Domains<N>*, int, int);
+		bool pending_fits(Square<N>*, Domains<N>*, int, int);
+		int count_pending(Square<N>*, int);
+		int count_places(Square<N>*, Domains<N>*, int);
+		bool seeds_fit(Square<N>*, Domains<N>*);
+		int choose_seed(Square<N>*, Domains<N>*, int);
+		void run_task(Task<N>&, Worker<N>*);
+		void merge_found(Scheduler<N>*);
+		void found_square(Square<N>*, Worker<N>*);
+		int choose_index(Square<N>*);
+		bool stopped();
+		bool halted_for(Worker<N>*);
+		void check_clock(Worker<N>*);
+		void halt(string);
+		bool accept(int);
+		void search_queue(vector<Domains<N> >&, vector<bool>&);
+		void search_shards(vector<Domains<N> >&, vector<bool>&);
+		long search_shard(Shard&, int, vector<Domains<N> >&);
+		void merge_shard(Shard&, vector<string>&);
+		void add_counts(Worker<N>*);
+		void restore_checkpoint(deque<int>&, vector<vector<int> >&);
+		void save_checkpoint(deque<int>&, vector<vector<int> >&);
+		void init_worker(Worker<N>*);
+		int* buffer_at(Worker<N>*, int);
+		Span get_candidates(uint64, int*, bool* missed = NULL);
+		int count_candidates(uint64);
+
+		// scored search for the best squares, see --top
+		long score_bound(Square<N>*);
+		long pattern_max(uint64);
+		long open_max(Square<N>*, int);
+		void rank_square(Square<N>*);
+		void write_top();
+
+		// row filling search with the trie engine
+		void start_rows(Square<N>*, Worker<N>*, int);
+		void gen_rows(Square<N>*, int*, int, Worker<N>*, int);
+		void fill_row(Square<N>*, int*, int, int, int, char*, int*, int&, Worker<N>*, int);
+		void found_rows(Square<N>*, Worker<N>*);
+		int row_score(Square<N>&);
 
 		// private wordsquare objects
-		vector<Square> squares;
+		vector<Square<N> > squares;
 		string seedfile;
 		vector<string> seedwords;
 		int seedsize;
+		vector<string> forms;	// each seedword at each alignment, padded with '-' to N characters
+		vector<int> formseed;	// the seedword of each form
+		vector<int> firstform;	// the forms of seedword k are firstform[k] to firstform[k+1]-1
+		unsigned placed;		// bit k set if seedword k is placed in the seedsquares, the search places the rest
+		bool seed_tree;			// place only the first seedword in the seedsquares
 
 		int num_seedsquares;
 
@@ -58,8 +152,79 @@ class Squares{
 		Dict *dict;
 		Regs *regs;
 		Matches *matches;
+		Bitsets *bitsets;		// used instead of regs and matches if not NULL
+		Trie *trie;				// fill rows in order with prefix lookups if not NULL
+		vector<bool> flipped;	// seedsquares the trie engine searches transposed
 		
-		string outfile;
+		Writer *writer;
+
+		// parallel search settings
+		int numthreads;
+		bool ordered;			// merge found squares in single threaded order
+		int split_depth;		// search levels above this depth become stealable tasks
+		Scheduler<N> *scheduler;	// NULL when searching on one thread
+
+		// sharded search on worker processes, see Coordinator
+		int numprocs;
+		long worker_mem;
+		vector<int> seedshards;	// shards of each seedsquare not merged yet
+
+		// prune with per-cell letter domains
+		bool forward_check;
+
+		// skip partial squares already searched without a solution, NULL if not
+		Nogoods *nogoods;
+		long nogood_mb;
+		NogoodCounts nogood_counts;	// summed over workers when the search ends
+
+		// keep only the top best squares by the weights of their words, 0 for every square
+		struct Ranked {
+			long score;
+			long seq;			// order found, the earlier of equal scores ranks first
+			Square<N> sqr;
+		};
+		long top;
+		vector<Ranked> best;	// a heap with the lowest ranked square at the front
+		long numranked;			// squares scored
+
+		// fill the most constrained word first, rather than in index order
+		bool dynamic_order;
+
+		// make seedsquares arc consistent before searching them
+		bool root_ac;
+
+		// drop solutions equal to an earlier one or its transpose, with --dedupe
+		bool dedupe;
+		Seen seen_solutions;
+
+		// seedsquares equal to an earlier one or its transpose are always dropped
+		set<string> seen_seeds;
+		int dup_seeds;
+
+		atomic<bool> *stop;		// stop searching when set, NULL if never
+		bool verbose;			// print search statistics
+		int tag;				// written with each square, 0 for none
+		atomic<long> numfound;	// squares written, the writer may be shared
+		long numnodes;			// search nodes visited, summed over workers when the search ends
+		Stats *stats;			// collects the workers' counters in a WS_STATS build, NULL if not
+
+		// limits for anytime answers, 0 for none
+		long max_solutions;
+		long deadline;			// ms after the search starts
+		long max_per_seed;
+		chrono::steady_clock::time_point start;
+		atomic<bool> halted;	// a limit stopped the search
+		string halt_reason;
+		mutex haltlock;
+		atomic<long> numaccepted;				// squares let through the limits
+		vector<atomic<long> > seedfound;		// squares let through per seedsquare
+		int numfinished;		// seedsquares searched to the end, when searching on one thread
+		int numalive;			// seedsquares left to search after prepare_seedsquares
+		atomic<int> numcapped;	// seedsquares stopped by max_per_seed
+
+		// save the search to continue later, when searching on one thread
+		Checkpoint *checkpoint;	// NULL if not
+		bool checkpoint_due;	// suspend the search at the next node and write the checkpoint
 
 };
 #endif
@@ -0,0 +1,199 @@
+/*
+	Search statistics implementation, Stats.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	SIGUSR1 is blocked in every thread and taken by a listener thread
+	with sigwait, so the dump runs as normal code, not in a signal handler.
+	The counters of threads still searching are read while they change,
+	so a dump taken on SIGUSR1 is a close snapshot, not an exact one
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+// zero every counter
+StatCounters::StatCounters() {
+	for(int d=0; d<STATS_DEPTHS; d++) {
+		nodes[d] = 0;
+		misses[d] = 0;
+		empty[d] = 0;
+		solutions[d] = 0;
+		for(int b=0; b<STATS_BUCKETS; b++) lengths[d][b] = 0;
+	}
+}
+
+// sum one counter over every depth
+long StatCounters::total(atomic<long>* c) {
+	long sum = 0;
+	for(int d=0; d<STATS_DEPTHS; d++) sum += c[d].load(memory_order_relaxed);
+	return sum;
+}
+
+/*
+	Start collecting, dumps go to outfile.
+	Must be created before any other thread,
+	so every thread inherits SIGUSR1 blocked
+*/
+Stats::Stats(string str) {
+	outfile = str;
+	seeds = NULL;
+	numseeds = 0;
+	closing = false;
+	closed = false;
+	start = chrono::steady_clock::now();
+
+	sigset_t set;
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+	listener = thread(&Stats::listen, this);
+}
+
+// dump the final counts if close was never called
+Stats::~Stats() {
+	close();
+	delete [] seeds;
+}
+
+// make room for the totals of each seedsquare
+void Stats::set_numseeds(int n) {
+	lock_guard<mutex> guard(lock);
+	delete [] seeds;
+	numseeds = n;
+	seeds = new SeedCounters[n];
+	for(int i=0; i<n; i++) {
+		seeds[i].nodes = 0;
+		seeds[i].misses = 0;
+		seeds[i].empty = 0;
+		seeds[i].solutions = 0;
+	}
+}
+
+// include a search thread's counters in dumps
+void Stats::add(StatCounters* c) {
+	lock_guard<mutex> guard(lock);
+	live.push_back(c);
+}
+
+// fold the counters of a thread that's done into the totals, before they're freed
+void Stats::retire(StatCounters* c) {
+	lock_guard<mutex> guard(lock);
+	for(int d=0; d<STATS_DEPTHS; d++) {
+		stat_add(retired.nodes[d], c->nodes[d]);
+		stat_add(retired.misses[d], c->misses[d]);
+		stat_add(retired.empty[d], c->empty[d]);
+		stat_add(retired.solutions[d], c->solutions[d]);
+		for(int b=0; b<STATS_BUCKETS; b++) stat_add(retired.lengths[d][b], c->lengths[d][b]);
+	}
+	live.erase( remove(live.begin(), live.end(), c), live.end() );
+}
+
+// record a thread's totals, to be compared by add_seed
+void Stats::mark(StatCounters* c, long* snapshot) {
+	snapshot[0] = c->total(c->nodes);
+	snapshot[1] = c->total(c->misses);
+	snapshot[2] = c->total(c->empty);
+	snapshot[3] = c->total(c->solutions);
+}
+
+// add what a thread counted since mark to the totals of a seedsquare
+void Stats::add_seed(int seed, StatCounters* c, long* snapshot) {
+	if( seed < 0 || seed >= numseeds ) return;
+	long now[4];
+	mark(c, now);
+	seeds[seed].nodes += now[0] - snapshot[0];
+	seeds[seed].misses += now[1] - snapshot[1];
+	seeds[seed].empty += now[2] - snapshot[2];
+	seeds[seed].solutions += now[3] - snapshot[3];
+}
+
+// stop the listener and write the final counts
+void Stats::close() {
+	if( closed ) return;
+	closed = true;
+	closing = true;
+	pthread_kill(listener.native_handle(), SIGUSR1);
+	listener.join();
+	dump(true);
+	cout << "wrote search statistics to " << outfile << endl;
+}
+
+// listener thread, dump on every SIGUSR1 until closing
+void Stats::listen() {
+	sigset_t set;
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	while( true ) {
+		int sig;
+		if( sigwait(&set, &sig) != 0 ) continue;
+		if( closing ) return;
+		dump(false);
+	}
+}
+
+/*
+	Write the counters as JSON, replacing the file in one rename
+	so a reader never sees half a dump.  
+	Depths with no nodes and seedsquares never searched are left out.
+	Histogram buckets are named by the list lengths they hold
+*/
+void Stats::dump(bool final) {
+	lock_guard<mutex> guard(lock);
+	StatCounters sum;
+	vector<StatCounters*> all = live;
+	all.push_back(&retired);
+	for(unsigned i=0; i<all.size(); i++) {
+		for(int d=0; d<STATS_DEPTHS; d++) {
+			stat_add(sum.nodes[d], all[i]->nodes[d]);
+			stat_add(sum.misses[d], all[i]->misses[d]);
+			stat_add(sum.empty[d], all[i]->empty[d]);
+			stat_add(sum.solutions[d], all[i]->solutions[d]);
+			for(int b=0; b<STATS_BUCKETS; b++) stat_add(sum.lengths[d][b], all[i]->lengths[d][b]);
+		}
+	}
+
+	long ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+	string json = "{\"final\":" + string(final ? "true" : "false") + ",\"elapsed_ms\":" + to_string(ms);
+	json += ",\"nodes\":" + to_string(sum.total(sum.nodes));
+	json += ",\"solutions\":" + to_string(sum.total(sum.solutions));
+	json += ",\n\"depths\":[";
+	bool first = true;
+	for(int d=0; d<STATS_DEPTHS; d++) {
+		if( sum.nodes[d] == 0 ) continue;
+		json += first ? "\n" : ",\n";
+		first = false;
+		json += "{\"depth\":" + to_string(d) + ",\"nodes\":" + to_string(sum.nodes[d]);
+		json += ",\"reg_misses\":" + to_string(sum.misses[d]) + ",\"empty_matches\":" + to_string(sum.empty[d]);
+		json += ",\"solutions\":" + to_string(sum.solutions[d]) + ",\"candidates\":{";
+		bool firstb = true;
+		for(int b=0; b<STATS_BUCKETS; b++) {
+			if( sum.lengths[d][b] == 0 ) continue;
+			string range = b == 0 ? "0" : b == 1 ? "1" : to_string(1L << (b-1)) + "-" + to_string((1L << b) - 1);
+			if( b == STATS_BUCKETS-1 ) range = to_string(1L << (b-1)) + "+";
+			json += string(firstb ? "" : ",") + "\"" + range + "\":" + to_string(sum.lengths[d][b]);
+			firstb = false;
+		}
+		json += "}}";
+	}
+	json += "],\n\"seedsquares\":[";
+	first = true;
+	for(int i=0; i<numseeds; i++) {
+		if( seeds[i].nodes == 0 ) continue;
+		json += first ? "\n" : ",\n";
+		first = false;
+		json += "{\"seed\":" + to_string(i) + ",\"nodes\":" + to_string(seeds[i].nodes);
+		json += ",\"reg_misses\":" + to_string(seeds[i].misses) + ",\"empty_matches\":" + to_string(seeds[i].empty);
+		json += ",\"solutions\":" + to_string(seeds[i].solutions) + "}";
+	}
+	json += "]}\n";
+
+	string tmpfile = outfile + ".tmp";
+	ofstream out(tmpfile.c_str());
+	out << json;
+	out.close();
+	if( !out || rename(tmpfile.c_str(), outfile.c_str()) != 0 ) {
+		cout << "ERROR: cannot write search statistics to " << outfile << endl;
+	}
+}
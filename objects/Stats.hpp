@@ -0,0 +1,96 @@
+/*
+	Search statistics header, Stats.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Counters of where the search spends its work, for each search depth:
+	nodes expanded, constraint patterns missing from Regs, 
+	patterns whose match list is empty, a histogram of candidate list 
+	lengths, and solutions found.  Each seedsquare also gets its totals.
+	Written as JSON when the search ends, and on SIGUSR1 while it runs.
+
+	Only compiled in with -DWS_STATS, make STATS=1, 
+	the STAT() hooks in the search are empty otherwise.
+	Each search thread counts in its own StatCounters, with plain 
+	loads and stores rather than locked increments, so counting
+	adds little to the search.  Seedsquare totals are added 
+	when a thread finishes a seedsquare or a task
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#ifdef WS_STATS
+#define STAT(x) x
+#else
+#define STAT(x)
+#endif
+
+#define STATS_DEPTHS (2*MAXLEN+1)
+#define STATS_BUCKETS 24
+
+/* add to a counter only one thread writes, others may read it */
+inline void stat_add(atomic<long>& c, long n = 1) {
+	c.store( c.load(memory_order_relaxed) + n, memory_order_relaxed );
+}
+
+/* histogram bucket of a candidate list length: 0, 1, 2-3, 4-7, ... */
+inline int stat_bucket(long len) {
+	int b = len == 0 ? 0 : 64 - __builtin_clzll(len);
+	return b < STATS_BUCKETS ? b : STATS_BUCKETS-1;
+}
+
+/* the counters of one search thread */
+struct StatCounters {
+	atomic<long> nodes[STATS_DEPTHS];
+	atomic<long> misses[STATS_DEPTHS];		// pattern not in Regs
+	atomic<long> empty[STATS_DEPTHS];		// no candidate words
+	atomic<long> solutions[STATS_DEPTHS];
+	atomic<long> lengths[STATS_DEPTHS][STATS_BUCKETS];
+
+	StatCounters();
+	long total(atomic<long>*);
+};
+
+/* totals of one seedsquare, added by any thread */
+struct SeedCounters {
+	atomic<long> nodes;
+	atomic<long> misses;
+	atomic<long> empty;
+	atomic<long> solutions;
+};
+
+class Stats {
+
+	public:
+		Stats(string);
+		~Stats();
+
+		void set_numseeds(int);
+		void add(StatCounters*);
+		void retire(StatCounters*);
+		void add_seed(int, StatCounters*, long*);
+		void close();
+
+		static void mark(StatCounters*, long*);
+
+	private:
+		void listen();
+		void dump(bool);
+
+		string outfile;
+		StatCounters retired;			// counters of threads that are done
+		vector<StatCounters*> live;		// counters of threads still searching
+		SeedCounters* seeds;
+		int numseeds;
+		mutex lock;
+
+		chrono::steady_clock::time_point start;
+		thread listener;				// waits for SIGUSR1
+		atomic<bool> closing;
+		bool closed;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/*
+	Prefix trie engine implementation, Trie.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Builds the flat array trie of a wordlist, breadth first,
+	from the words sorted so every node's words are a contiguous range
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+// Default Constructor
+Trie::Trie() {
+	wordlen = 0;
+}
+
+// Build the trie of a wordlist
+Trie::Trie(Dict* dict) {
+	build(dict);
+}
+
+/*
+	Sort the word indices by word, then create the nodes level by level.
+	Each node covers the range of sorted words sharing its prefix,
+	and its children split that range by the next character.
+	'-' sorts before the letters but has the highest bit,
+	so a child's slot is taken from its bit, not from the order of the ranges.
+	A word listed twice keeps its first index
+*/
+void Trie::build(Dict* dict) {
+	cout << "building trie engine" << endl;
+	int numwords = dict->get_size();
+	wordlen = dict->get_wordlen();
+
+	vector<int> order(numwords);
+	for(int i=0; i<numwords; i++) order[i] = i;
+	stable_sort( order.begin(), order.end(), [dict, this](int a, int b) {
+		return memcmp( dict->get_chars(a), dict->get_chars(b), wordlen ) < 0;
+	} );
+
+	// node, range of sorted words it covers, and depth
+	struct Span { int node, lo, hi, depth; };
+	deque<Span> queue;
+	mask.assign(1, 0);
+	first.assign(1, 0);
+	if( numwords > 0 ) queue.push_back( {0, 0, numwords, 0} );
+
+	while( !queue.empty() ) {
+		Span s = queue.front();
+		queue.pop_front();
+		if( s.depth == wordlen ) {
+			first[s.node] = order[s.lo];
+			continue;
+		}
+
+		unsigned m = 0;
+		for(int i=s.lo; i<s.hi; i++) {
+			m |= char_bit( dict->get_chars(order[i])[s.depth] );
+		}
+		mask[s.node] = m;
+		first[s.node] = mask.size();
+		mask.resize( mask.size() + __builtin_popcount(m), 0 );
+		first.resize( mask.size(), 0 );
+
+		int lo = s.lo;
+		while( lo < s.hi ) {
+			char c = dict->get_chars(order[lo])[s.depth];
+			int hi = lo+1;
+			while( hi < s.hi && dict->get_chars(order[hi])[s.depth] == c ) hi++;
+			queue.push_back( {child(s.node, char_bit(c)), lo, hi, s.depth+1} );
+			lo = hi;
+		}
+	}
+
+	cout << "built trie of " << mask.size() << " nodes in " << get_bytes()/1024 << " KB" << endl << endl;
+}
+
+// return the root node, the empty prefix
+int Trie::get_root() {
+	return 0;
+}
+
+// return the number of nodes
+long Trie::get_numnodes() {
+	return mask.size();
+}
+
+// return the memory taken by the nodes, in bytes
+long Trie::get_bytes() {
+	return mask.size()*sizeof(unsigned) + first.size()*sizeof(int);
+}
@@ -0,0 +1,392 @@
+/*
+	Streaming wordsquare writer implementation, Writer.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	The queue is a bounded multi-producer ring buffer.
+	Every slot carries a sequence number: a producer may fill the slot 
+	when it equals the producer's ticket, and the writer may empty it
+	when it equals the ticket plus one.
+	The writer thread sleeps when the queue is empty.  The buffer is only
+	written every FLUSH_MS anyway, so squares can wait in the queue: 
+	the producer of every WAKE_SQUARES-th square wakes the writer, 
+	before the queue fills, and the writer wakes itself to write the buffer.
+	It marks itself sleeping before its last look at the queue, and the
+	producer looks at the mark after filling its slot, with a full fence
+	on each side, so either the writer sees the square or it's woken.
+
+	In text format the first line, "found N wordsquares", 
+	is written with room to spare and rewritten with the final count
+	when the output is a file.  On stdout the count is written last.
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#include "wslib.hpp"
+
+#define QUEUE_SIZE 4096
+#define WAKE_SQUARES (QUEUE_SIZE/2)
+#define BUFFER_SIZE (1 << 20)
+#define FLUSH_MS 1000
+#define HEADER_WIDTH 40
+
+// set by the SIGINT handler, checked by the writer thread
+static atomic<bool> interrupted(false);
+
+/*
+	Open the output, "-" for stdout, and start the writer thread.
+	format is "text" or "ndjson", len is the width of the squares
+*/
+Writer::Writer(string str, string format, int len) {
+	outfile = str;
+	if( outfile == "-" ) {
+		fd = STDOUT_FILENO;
+	} else {
+		fd = open( outfile.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644 );
+		if( fd < 0 ) {
+			cout << "ERROR: cannot open output file " << outfile << endl;
+			cout << "exiting program" << endl;
+			exit(-1);
+		}
+	}
+	owns_fd = (fd != STDOUT_FILENO);
+	start(format, len, 0, 0);
+}
+
+/*
+	Continue an output file written up to offset with count squares, 
+	as a checkpoint recorded it.  Anything written after is cut off,
+	and squares are numbered on from count
+*/
+Writer::Writer(string str, string format, int len, long count, long offset) {
+	outfile = str;
+	fd = open( outfile.c_str(), O_WRONLY );
+	if( fd < 0 || ftruncate(fd, offset) != 0 ) {
+		cout << "ERROR: cannot continue output file " << outfile << endl;
+		cout << "exiting program" << endl;
+		exit(-1);
+	}
+	owns_fd = true;
+	start(format, len, count, offset);
+}
+
+/*
+	Write to a descriptor the caller owns and closes, like a socket.
+	The text count goes at the end, as on stdout
+*/
+Writer::Writer(int out, string format, int len) {
+	outfile = "descriptor " + to_string(out);
+	fd = out;
+	owns_fd = false;
+	start(format, len, 0, 0);
+}
+
+/*
+	set up the queue and the header, and start the writer thread.
+	A continued output starts with count squares, offset bytes in
+*/
+void Writer::start(string format, int len, long start_count, long offset) {
+	ndjson = (format == "ndjson");
+	grids = (format == "grid");
+	scored = false;
+	wordlen = len;
+	count = start_count;
+	pushed = start_count;
+	syncing = false;
+	closing = false;
+	closed = false;
+	error = 0;
+	sleeping = false;
+
+	ring = new Slot[QUEUE_SIZE];
+	mask = QUEUE_SIZE-1;
+	for(size_t i=0; i<QUEUE_SIZE; i++) {
+		ring[i].seq = i;
+	}
+	tail = 0;
+	head = 0;
+
+	seekable = lseek(fd, 0, SEEK_CUR) == 0;
+	buffer.reserve(BUFFER_SIZE + 1024);
+	if( offset > 0 ) {
+		lseek(fd, offset, SEEK_SET);
+	} else if( !ndjson && !grids && seekable ) {
+		write_header();
+		lseek(fd, HEADER_WIDTH+2, SEEK_SET);
+	}
+
+	writer = thread(&Writer::run, this);
+}
+
+// finish writing if close was never called
+Writer::~Writer() {
+	close();
+	delete [] ring;
+}
+
+/*
+	Queue a solved square, its grid of wordlen*wordlen characters row by row, 
+	for writing, with its tag, 0 for none, and its score.  
+	Called from any search thread.
+	If the queue is full, wait for the writer thread to catch up
+*/
+void Writer::push(const char* grid, int tag, long score) {
+	size_t pos = tail.load(memory_order_relaxed);
+	Slot* slot;
+	while( true ) {
+		slot = &ring[pos & mask];
+		size_t seq = slot->seq.load(memory_order_acquire);
+		long dif = (long)seq - (long)pos;
+		if( dif == 0 ) {
+			if( tail.compare_exchange_weak(pos, pos+1, memory_order_relaxed) ) break;
+		} else if( dif < 0 ) {
+			this_thread::yield();
+			pos = tail.load(memory_order_relaxed);
+		} else {
+			pos = tail.load(memory_order_relaxed);
+		}
+	}
+	memcpy(slot->grid, grid, wordlen*wordlen);
+	slot->tag = tag;
+	slot->score = score;
+	slot->seq.store(pos+1, memory_order_release);
+	pushed++;
+	if( (pos & (WAKE_SQUARES-1)) == WAKE_SQUARES-1 ) {
+		atomic_thread_fence(memory_order_seq_cst);
+		if( sleeping.load(memory_order_relaxed) ) wake();
+	}
+}
+
+// wake the writer thread, taking the lock so the wake can't fall between its check and its wait
+void Writer::wake() {
+	{
+		lock_guard<mutex> guard(lock);
+	}
+	wakeup.notify_one();
+}
+
+// test if the writer thread has work: a square queued, a sync, a close, or an interrupt
+bool Writer::ready() {
+	return ring[head & mask].seq.load(memory_order_acquire) == head+1
+		|| syncing || closing || interrupted;
+}
+
+// take the next square off the queue, only called by the writer thread
+bool Writer::pop(char* grid, int& tag, long& score) {
+	Slot* slot = &ring[head & mask];
+	if( slot->seq.load(memory_order_acquire) != head+1 ) return false;
+	memcpy(grid, slot->grid, wordlen*wordlen);
+	tag = slot->tag;
+	score = slot->score;
+	slot->seq.store(head+mask+1, memory_order_release);
+	head++;
+	return true;
+}
+
+// write the score pushed with each square, call before the first push
+void Writer::set_scored() {
+	scored = true;
+}
+
+/*
+	Writer thread loop.
+	Drain the queue into the buffer, write the buffer when it's full
+	or once FLUSH_MS has passed, and finish once closing is set and the queue is empty.
+	With nothing queued, sleep until a push of many squares, a sync, 
+	or a close wakes the thread, or the buffer is due to be written.  A signal handler can't wake it,
+	so the sleep is at most FLUSH_MS, the longest Ctrl-C can wait.
+	On SIGINT, if caught, write out everything queued so far and exit the program
+*/
+void Writer::run() {
+	char grid[MAXLEN*MAXLEN];
+	int tag;
+	long score;
+	auto last = chrono::steady_clock::now();
+	while( true ) {
+		bool got = false;
+		while( pop(grid, tag, score) ) {
+			format(grid, tag, score);
+			got = true;
+			if( buffer.size() >= BUFFER_SIZE ) flush();
+		}
+		if( interrupted ) {
+			flush();
+			if( !ndjson && !grids && seekable ) write_header();
+			cerr << endl << "interrupted, wrote " << count << " wordsquares to " << outfile << endl;
+			_exit(130);
+		}
+		if( syncing && !got && tail.load() == head ) {
+			flush();
+			if( !ndjson && !grids && seekable ) write_header();
+			{
+				lock_guard<mutex> guard(lock);
+				syncing = false;
+			}
+			synced.notify_all();
+		}
+		if( closing && !got && tail.load() == head ) break;
+		auto now = chrono::steady_clock::now();
+		long waited = chrono::duration_cast<chrono::milliseconds>(now - last).count();
+		if( waited >= FLUSH_MS ) {
+			flush();
+			last = now;
+			waited = 0;
+		}
+		if( got ) continue;
+		unique_lock<mutex> guard(lock);
+		sleeping = true;
+		atomic_thread_fence(memory_order_seq_cst);
+		wakeup.wait_for(guard, chrono::milliseconds(FLUSH_MS - waited),
+			[this]() { return ready(); });
+		sleeping = false;
+	}
+	flush();
+}
+
+/*
+	Append one square to the buffer.
+	Text is the original format, numbered from 1, with a blank line
+	between squares.  NDJSON lists the rows and the columns.
+	A tag is written after the number as the square's query,
+	and a score after that when scored.
+	Grid is a line with the rows run together, for the Coordinator
+*/
+void Writer::format(const char* grid, int tag, long score) {
+	count++;
+	if( grids ) {
+		buffer += "square ";
+		buffer.append(grid, wordlen*wordlen);
+		buffer += "\n";
+		return;
+	}
+	if( ndjson ) {
+		buffer += "{\"index\":" + to_string(count);
+		if( tag > 0 ) buffer += ",\"query\":" + to_string(tag);
+		if( scored ) buffer += ",\"score\":" + to_string(score);
+		buffer += ",\"rows\":[";
+		for(int i=0; i<2*wordlen; i++) {
+			if( i == wordlen ) buffer += "],\"columns\":[";
+			else if( i > 0 ) buffer += ",";
+			buffer += "\"" + get_word(grid, i) + "\"";
+		}
+		buffer += "]}\n";
+		return;
+	}
+	if( count > 1 ) buffer += "\n\n";
+	buffer += to_string(count) + ": ";
+	if( tag > 0 ) buffer += "query " + to_string(tag);
+	if( tag > 0 && scored ) buffer += " ";
+	if( scored ) buffer += "score " + to_string(score);
+	buffer += "\n\n";
+	for(int i=0; i<2*wordlen; i++) {
+		buffer += to_string(i) + ": " + get_word(grid, i) + "\n";
+	}
+}
+
+/*
+	return the word at a position of a grid, 
+	rows first and then columns, as Square numbers them
+*/
+string Writer::get_word(const char* grid, int index) {
+	string word(wordlen, '*');
+	for(int i=0; i<wordlen; i++) {
+		word[i] = index < wordlen ? grid[index*wordlen + i] : grid[i*wordlen + index-wordlen];
+	}
+	return word;
+}
+
+/*
+	write the buffer out and empty it.  A write cut short by a signal
+	is tried again, any other failure is kept as the error,
+	and nothing more is written after it
+*/
+void Writer::flush() {
+	size_t done = 0;
+	while( error == 0 && done < buffer.size() ) {
+		ssize_t n = ::write( fd, buffer.data()+done, buffer.size()-done );
+		if( n < 0 && errno == EINTR ) continue;
+		if( n <= 0 ) {
+			error = n < 0 ? errno : EIO;
+			break;
+		}
+		done += n;
+	}
+	buffer.clear();
+}
+
+/*
+	Write the text header at the start of the file,
+	padded to a fixed width so it can be rewritten in place with the final count
+*/
+void Writer::write_header() {
+	if( error != 0 ) return;
+	string header = "found " + to_string(count) + " wordsquares";
+	header.resize(HEADER_WIDTH, ' ');
+	header += "\n\n";
+	ssize_t n;
+	do {
+		n = pwrite(fd, header.data(), header.size(), 0);
+	} while( n < 0 && errno == EINTR );
+	if( n != (ssize_t)header.size() ) error = n < 0 ? errno : EIO;
+}
+
+/*
+	Wait for every queued square to be written, then finish the output:
+	the final count goes in the header, or at the end on stdout
+*/
+void Writer::close() {
+	if( closed ) return;
+	closed = true;
+	{
+		lock_guard<mutex> guard(lock);
+		closing = true;
+	}
+	wakeup.notify_one();
+	writer.join();
+	if( !ndjson && !grids ) {
+		if( seekable ) {
+			write_header();
+		} else {
+			buffer = "\n\nfound " + to_string(count) + " wordsquares\n";
+			flush();
+		}
+	}
+	if( owns_fd ) ::close(fd);
+}
+
+// return the number of squares pushed so far
+long Writer::get_count() {
+	return pushed;
+}
+
+// return the errno of the write that failed, 0 if every write succeeded
+int Writer::get_error() {
+	return error;
+}
+
+/*
+	Wait until every square pushed so far is written out,
+	then return the size of the output in bytes.
+	Only when no other thread is pushing, as when taking a checkpoint
+*/
+long Writer::sync() {
+	unique_lock<mutex> guard(lock);
+	syncing = true;
+	wakeup.notify_one();
+	synced.wait(guard, [this]() { return !syncing; });
+	return lseek(fd, 0, SEEK_CUR);
+}
+
+/*
+	Make Ctrl-C write out every square queued and exit the program,
+	for a run with one Writer.  Set once for the process, not per Writer,
+	since the first Writer to see it exits
+*/
+void Writer::catch_interrupt() {
+	signal(SIGINT, Writer::on_interrupt);
+}
+
+// SIGINT handler, the writer thread does the work
+void Writer::on_interrupt(int sig) {
+	interrupted = true;
+}
@@ -0,0 +1,106 @@
+/*
+	Streaming wordsquare writer header, Writer.hpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Writes solved squares to a file, or to stdout, as they are found.
+	Search threads push squares onto a bounded lock-free queue,
+	and a background thread formats them into a large buffer
+	and writes the buffer out when it fills, about once a second, 
+	and when the program is interrupted, see catch_interrupt.
+	The writer thread sleeps on a condition variable while the queue
+	is empty, and is woken once every many squares pushed,
+	or by sync and close, or when the buffer is due to be written.
+	Memory use stays the same however many squares are found,
+	a full queue makes the search threads wait for the writer.
+	Squares are queued as their grids of characters, 
+	so one Writer serves every square width.
+
+	Two formats are supported:
+		- text, the original output format, see the README
+		- ndjson, one JSON object per line per square
+	and a third for shard workers to send squares back to the Coordinator,
+		- grid, "square " and the rows of the square run together
+	A square can be pushed with a tag, the batch query it solves,
+	so the squares of many queries can share one output,
+	and with a score, written once set_scored is called, for --top.
+	For a checkpoint, sync writes out everything pushed so far,
+	and a later run can continue the output from there.
+	Once a write fails the output is given up, later squares are 
+	taken off the queue and dropped so no search thread waits on it,
+	and get_error tells the caller
+
+	This software is distributed under 
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+
+#ifndef WRITER_HPP
+#define WRITER_HPP
+
+class Writer {
+
+	public:
+		Writer(string, string, int);
+		Writer(int, string, int);
+		Writer(string, string, int, long, long);
+		~Writer();
+
+		void push(const char*, int tag = 0, long score = 0);
+		void set_scored();
+		void close();
+
+		long get_count();
+		long sync();
+		int get_error();
+
+		static void catch_interrupt();
+
+	private:
+		// one entry of the queue, seq tells producers and the consumer whose turn it is
+		struct Slot {
+			atomic<size_t> seq;
+			char grid[MAXLEN*MAXLEN];
+			int tag;
+			long score;
+		};
+
+		void start(string, int, long, long);
+		bool pop(char*, int&, long&);
+		void run();
+		void format(const char*, int, long);
+		string get_word(const char*, int);
+		void flush();
+		void write_header();
+		bool ready();
+		void wake();
+		static void on_interrupt(int);
+
+		Slot* ring;
+		size_t mask;				// queue capacity - 1, capacity is a power of 2
+		atomic<size_t> tail;		// next slot to push, shared by producers
+		size_t head;				// next slot to pop, owned by the writer thread
+
+		string outfile;
+		bool ndjson;
+		bool grids;					// the bare grid lines of a shard worker, see Coordinator
+		bool scored;				// write each square's score
+		int wordlen;				// width of the squares
+		int fd;
+		bool owns_fd;				// close fd when done
+		bool seekable;				// the text header can be patched when done
+		string buffer;
+		long count;					// squares formatted so far
+		atomic<long> pushed;		// squares pushed so far
+
+		thread writer;
+		atomic<bool> syncing;		// set by sync, cleared by the writer thread once all is written
+		atomic<bool> closing;
+		bool closed;
+		atomic<int> error;			// errno of the first write that failed, 0 if none
+
+		mutex lock;					// guards the waits below
+		condition_variable wakeup;	// the writer thread waits here for work
+		condition_variable synced;	// sync waits here for the writer thread
+		atomic<bool> sleeping;		// the writer thread is waiting, or about to, on wakeup
+};
+
+#endif
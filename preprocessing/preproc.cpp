@@ -9,6 +9,14 @@
 		- A matrix of size wordlist*number_of_regexes, 
 		  where an entry in the matrix is 1 if a word can be represented by the regex
 	
+	Optionally, all 3 data structures are also written to a single binary index file
+	that the wordsquare program can memory map and use without parsing.
+	The index layout is described in lib/wsindex.hpp
+
+	Words can be given weights, scores of how good they are to use,
+	from a file of word and weight lines.  They are written next to
+	each word of the Dict and in the index, for the --top search
+	
 	For more detail on how the 3 data structures are used, and further elaboration
 	on the merits of preprocessing, see the README
 	
@@ -20,6 +28,11 @@
 #include <fstream>
 #include <vector>
 #include <set>
+#include <map>
+#include <string>
+#include <thread>
+#include <cstdlib>
+#include "wsindex.hpp"
 
 using namespace std;
 
@@ -41,54 +54,68 @@ typedef unsigned long long uint64;
 void read_dict( set<string>&, string, int);
 string sanitize(string);
 
-/* create a vector that stores all possible regexes from the wordlist */
-vector<set<int> > gencombos(int);
-void gensets(set<int>, set<int>, set<int>, vector<set<int> >&);
-void populate_regexes(vector<string>&, vector<set<int> >&, char*, int, int, int);
-void populate_regset(set<string>&, char*, int, int, int);
+/* read in word weights */
+void read_weights( map<string, int>&, string );
+vector<int> word_weights( vector<string>&, map<string, int>& );
+
 vector<string> set2vec(set<string>&);
 
-/* generate the matches matrix */
-//void populate_matches( Bits*, vector<string>&, vector<string>&, int wordlen );
-void populate_matches( vector<int>&, vector<int>&, vector<string>&, vector<string>&, int);
+/*
+	generate the regex list and the matches matrix.
+	Sort entries pack a regex key above a word index of WORDBITS bits
+*/
+#define WORDBITS 24
+void build_matches(vector<string>&, int, int, vector<string>&, vector<int>&, vector<int>&);
+void gen_keys(vector<string>&, int, int, int, vector<uint64>&);
+void radix_sort(vector<uint64>&, vector<uint64>&, int, int, int);
 void write_matches_csc(vector<int>&, vector<int>&, string);
 
-
-bool match(string, string, int);
-
-void write_output(vector<int>&, vector<int>&, string );
+/* write all 3 data structures, and the weights if any, to one binary index */
+void write_index(vector<string>&, vector<string>&, vector<int>&, vector<int>&, vector<int>&, int, string);
 
 /* time */
 uint64 getTimeMs64();
 
 int main(int argc, char* argv[]) {
 
-	if(argc!=5) {
-		cout << "usage: ./preproc  dict_infile  dict_outfile  reg_outfile  matches_outfile" << endl;
+	/* 
+		optional thread count, -j N, word length, -n N, 
+		and word weights, -w file, before the file arguments 
+	*/
+	int numthreads = thread::hardware_concurrency();
+	int wordlen = 5;
+	string weightfile = "";
+	int arg = 1;
+	while( arg+1 < argc && (string(argv[arg]) == "-j" || string(argv[arg]) == "-n" || string(argv[arg]) == "-w") ) {
+		if( string(argv[arg]) == "-j" ) numthreads = atoi(argv[arg+1]);
+		else if( string(argv[arg]) == "-n" ) wordlen = atoi(argv[arg+1]);
+		else weightfile = argv[arg+1];
+		arg += 2;
+	}
+	if( numthreads < 1 ) numthreads = 1;
+
+	if( (argc-arg!=4 && argc-arg!=5) || wordlen < 3 || wordlen > 8 ) {
+		cout << "usage: ./preproc  [-j threads]  [-n wordlen]  [-w weights_infile]  dict_infile  dict_outfile  reg_outfile  matches_outfile  [index_outfile]" << endl;
+		cout << "       wordlen from 3 to 8, default 5" << endl;
+		cout << "       weights_infile has a word and an integer weight on each line, other words weigh 0" << endl;
 		return -1;
 	}
 
 	/* initialize file strings */
-	string dictfile = argv[1];
-	string dictout = argv[2];
-	string regout = argv[3];
-	string matchesout = argv[4];
+	string dictfile = argv[arg];
+	string dictout = argv[arg+1];
+	string regout = argv[arg+2];
+	string matchesout = argv[arg+3];
+	string indexout = argc-arg==5 ? argv[arg+4] : "";
 	
 	/* key variables */
-	/* 
-	  if you're going to change wordlen be aware the read_dict() function only
-	  supports words smaller than wordlen when wordlen is 5.
-	  Without changes, changing wordlen will only allow wordsquares 
-	  with all words equal to the wordlen
-	*/
-	int wordlen = 5;
-	int numwords, numcombos, numregs;
+	int numwords, numregs;
 
 	uint64 total_start = getTimeMs64();
 
 	/* 
 		Load a dictionary/wordlist with 
-		words only of length "wordlen" (default 5)
+		words of length "wordlen" (default 5), see read_dict()
 	*/	
 	cout << "loading dictionary" << endl;
 	set<string> dictset;
@@ -98,104 +125,54 @@ int main(int argc, char* argv[]) {
 	numwords = dict.size();	
 	cout << "loaded " << numwords << " words" << endl << endl;
 
-	// write all 5-letter words to a new wordlist
-	cout << "writing 5-letter word file" << endl;
+	/* the weight of every word, if given, see read_weights() */
+	vector<int> weights;
+	if( !weightfile.empty() ) {
+		cout << "loading word weights" << endl;
+		map<string, int> weightmap;
+		read_weights( weightmap, weightfile );
+		weights = word_weights( dict, weightmap );
+		cout << "loaded " << weightmap.size() << " word weights" << endl << endl;
+	}
+
+	// write all wordlen-letter words to a new wordlist, each with its weight if any
+	cout << "writing " << wordlen << "-letter word file" << endl;
 	uint64 start = getTimeMs64();
 	ofstream outstream;
 	outstream.open( dictout.c_str() );
-	outstream << numwords << endl;
+	outstream << numwords << '\n';
 	for(int i=0; i<numwords; i++) {
-		outstream << dict[i] << endl;
+		outstream << dict[i];
+		if( !weights.empty() ) outstream << ' ' << weights[i];
+		outstream << '\n';
 	}
 	outstream.close();
-	cout << "wrote 5-letter word file in: " << (float)(getTimeMs64() - start)/1000 << " s" << endl << endl;
-
-	// Generate all possible combinations of indices from a word of length: wordlen
-	cout << "generating all regular expression combos from a word of length: " << wordlen << endl;
-	vector<set<int> > combos = gencombos(wordlen);
-	numcombos = combos.size();
-	cout << "generated " << numcombos << " combinations" << endl << endl;
-	
-
-	/* 
-		populate array of regexes formed from words in dictionary, duplicates included.
-		use the collection of sets generated from gencombos() 
-	*/
-	cout << "creating and populating array with all possible regular expressions from dictionary: " << dictfile << endl;
-	char* regexes;
-	regexes = new char[numcombos*wordlen*numwords];
-	for(int i=0; i<numcombos*wordlen*numwords; i++) regexes[i] = '*';
-	populate_regexes(dict, combos, regexes, numwords, numcombos, wordlen);
-	cout << "populated regex array with: " << numcombos * numwords << " entries,";
-	cout << "with " << numcombos*numwords*wordlen << " total characters" << endl << endl;
-
+	cout << "wrote " << wordlen << "-letter word file in: " << (float)(getTimeMs64() - start)/1000 << " s" << endl << endl;
 
 	/*
-		Create and populate a set with all regular expressions to eliminate duplicates
-		Then convert the set to a vector for easier access
-	*/	
-	cout << "populating collection of regular expressions" << endl;	
-	set<string> regset;
+		Generate every regex of every word, group them by regex,
+		and build the regex list and the csc matches matrix in one pass.
+		See build_matches()
+	*/
+	cout << "building regular expressions and matches with " << numthreads << " threads" << endl;
+	start = getTimeMs64();
 	vector<string> regs;
-	populate_regset( regset, regexes, numwords, numcombos, wordlen);
-	regs = set2vec(regset);
+	vector<int> csc1, csc2;
+	build_matches( dict, wordlen, numthreads, regs, csc1, csc2 );
 	numregs = regs.size();
-	delete [] regexes; //save mem, delete now
-	cout << "regex vector populated with " << numregs << " expressions" << endl << endl;
+	cout << "built " << numregs << " expressions with " << csc2.size() << " matches in " << (float)(getTimeMs64() - start)/1000 << " s" << endl << endl;
 
 	/* write all the regexes to a file */
 	cout << "writing regex file" << endl;
 	start = getTimeMs64();
 	outstream.open( regout.c_str() );
-	outstream << numregs<< endl;
+	outstream << numregs << '\n';
 	for(int i=0; i<numregs; i++) {
-		outstream << regs[i] << endl;
+		outstream << regs[i] << '\n';
 	}
 	outstream.close();
 	cout << "wrote regex word file in: " << (float)(getTimeMs64() - start)/1000 << " s" << endl << endl;
 
-
-	/*
-		Create and initialize matrix for word/regex matches
-		the matches array is a 2d matrix with words as rows and regexes as columns
-		the 2d matrix "matches" is stored as a single 1d array of length numwords*numregs.
-		To conserve space, entries in the matrix as represented by bits.
-		If a given entry is 1, then it means a given word can be represented by the regex,
-		e.g.  the entry at (word:route, regex: ro***) would be 1	
-		Initialize the matrix with zeroes.	
-	*/		
-	//cout << "initializing matrix array" << endl;
-	//Bits* matches;
-	
-	/*unsigned long numentries = (long)numwords*numregs;
-	unsigned long matchsize;
-	matchsize = numentries/8;	
-	matches = new Bits[ matchsize ];
-	for(long i=0; i<matchsize; i++) {
-		matches[i].bit0=0;
-		matches[i].bit1=0;
-		matches[i].bit2=0;
-		matches[i].bit3=0;
-		matches[i].bit4=0;
-		matches[i].bit5=0;
-		matches[i].bit6=0;
-		matches[i].bit7=0;
-	}*/
-	long num_entries = numwords*numcombos; //  27068*31
-	vector<int> csc1(numregs+1);
-	vector<int> csc2(num_entries);
-	
-	cout << "initialized csc matrix" << endl;
-	//cout << "intiailzed: " << numentries << " in array of size: " << matchsize << endl << endl; 
-
-
-	// Populate matches array by finding word/regex matches
-	cout << "populating array by finding all word/regex matches" << endl;
-	start = getTimeMs64();
-	//populate_matches( matches, dict, regs, wordlen );
-	populate_matches( csc1, csc2, dict, regs, wordlen);
-	cout << "matches array populated in " << (float)(getTimeMs64() - start)/1000 << " s" << endl << endl;
-
 	/* 
 		write the matches matrix to a file
 		first line is the size of the matches matrix in bytes
@@ -204,23 +181,29 @@ int main(int argc, char* argv[]) {
 	cout << "writing matches file" << endl;
 	start = getTimeMs64();
 	write_matches_csc(csc1, csc2, matchesout);
-	//outstream.open(matchesout.c_str());
-	//outstream << matchsize << endl;
-	//outstream.write(  reinterpret_cast< const char* >(matches), matchsize*sizeof(Bits)  );
-	//outstream.close();
 	cout << "matches csc file written in " << (float)(getTimeMs64() - start)/1000 << " s" << endl << endl;
 
+	/* write the binary index, if requested */
+	if( !indexout.empty() ) {
+		cout << "writing binary index file" << endl;
+		start = getTimeMs64();
+		write_index(dict, regs, csc1, csc2, weights, wordlen, indexout);
+		cout << "binary index written in " << (float)(getTimeMs64() - start)/1000 << " s" << endl << endl;
+	}
+
 	cout << "preprocessing complete" << endl;
 	cout << "total elapsed time: " << (float)(getTimeMs64()-total_start)/1000 <<  " s" << endl;
 
-	//delete [] matches;
-	
-
 	return 0;
 
 }
 
-// read only 5 letter words into dictionary/wordlist
+/*
+	read the words of length wordlen into the dictionary/wordlist.
+	Words one or two letters shorter, of at least 3 letters, are added too,
+	padded with '-' for the empty cells in every possible alignment,
+	e.g. for wordlen 5 "cat" is added as "--cat", "-cat-", and "cat--"
+*/
 void read_dict( set<string>& dict, string dictstr, int wordlen) {
 
 	string line;
@@ -231,24 +214,9 @@ void read_dict( set<string>& dict, string dictstr, int wordlen) {
 	while( getline(instream, line) ) {
 		line = sanitize(line);
 		len = line.size();
-		if ( len == wordlen ) {
-			dict.insert(line);
-		} 
-		/* hardcoded below to allow for 3 and 4 letter words in 5x5 wordsquares */
-		else if( wordlen==5 && len == 4) {
-			string str1, str2;
-			str1 = "-"+line;
-			str2 = line+"-";
-			dict.insert(str1);
-			dict.insert(str2);
-		} else if ( wordlen==5 && len == 3) {
-			string str1, str2, str3;
-			str1 = "--"+line;
-			str2 = "-"+line+"-";
-			str3 = line + "--";
-			dict.insert(str1);
-			dict.insert(str2);
-			dict.insert(str3);
+		if( len > wordlen || len < wordlen-2 || len < 3 ) continue;
+		for(int pad=0; pad<=wordlen-len; pad++) {
+			dict.insert( string(pad, '-') + line + string(wordlen-len-pad, '-') );
 		}
 	}
 
@@ -256,6 +224,49 @@ void read_dict( set<string>& dict, string dictstr, int wordlen) {
 }
 
 
+/*
+	read word weights, a word and an integer on each line,
+	e.g. "apple 40" or "hoys -25".  The word is sanitized like the wordlist
+*/
+void read_weights( map<string, int>& weights, string weightstr ) {
+
+	string line;
+	ifstream instream;
+	instream.open( weightstr.c_str() );
+	if( !instream ) {
+		cout << "ERROR: cannot open weights file " << weightstr << endl;
+		exit(-1);
+	}
+
+	while( getline(instream, line) ) {
+		size_t space = line.find_last_of(" \t");
+		if( space == string::npos ) continue;
+		string word = sanitize( line.substr(0, space) );
+		if( word.empty() ) continue;
+		weights[word] = atoi( line.c_str() + space + 1 );
+	}
+
+	return;
+}
+
+/*
+	the weight of each word of the dictionary, 0 if it has none.
+	A padded shorter word, "--cat", has the weight of "cat"
+*/
+vector<int> word_weights( vector<string>& dict, map<string, int>& weightmap ) {
+
+	vector<int> weights( dict.size(), 0 );
+	for(unsigned i=0; i<dict.size(); i++) {
+		string word = dict[i];
+		word.erase( 0, word.find_first_not_of('-') );
+		word.erase( word.find_last_not_of('-')+1 );
+		map<string, int>::iterator itr = weightmap.find(word);
+		if( itr != weightmap.end() ) weights[i] = itr->second;
+	}
+
+	return weights;
+}
+
 // all lower case, letters only
 string sanitize(string line) {
 
@@ -276,103 +287,96 @@ string sanitize(string line) {
 }
 
 /*
-	Initialize a set P with all indices for a word of given length,
-	e.g. for words of length 5, create a set P with {1,2,3,4,5},
-	then pass the set to gensets() to generate all possible subsets with those indices
+	convert a set to a sorted vector for easier access
 */
-vector<set<int> > gencombos(int wordlen) {
-
-	vector<set<int> > combos;
-	set<int> R, P, X;
-	for(int i=0; i<wordlen; i++) {
-		P.insert(i);
+vector<string> set2vec(set<string>& regset) {
+	vector<string> regvec;
+	set<string>::iterator itr;
+	for(itr = regset.begin(); itr != regset.end(); ++itr) {
+		regvec.push_back( *itr );
 	}
-	gensets( R, P, X, combos);
-
-	return combos;
+	regset.clear();
+	return regvec;
 }
 
 /*
-	Generate all possible subsets from a given input set,
-	e.g. for a set with {1,2,3,4,5}, compute all possible subsets,
-	like {1}, {1,2}, {1, 4}, {2,3}, etc.
+	Build the regex list and the matches matrix.
+	Every word of length wl, 3 to 8, is represented by 2^wl-1 regexes,
+	one for each nonempty subset of its positions kept as letters,
+	e.g. "route" gives "r****", "ro***", "**u**", "ro*te", etc.
+	The all-wildcard regex is left out, it matches every word.
+
+	Rather than testing every word against every regex,
+	each regex of each word is packed into an integer key (see wsindex.hpp)
+	next to the word's index, and the keys are sorted.
+	The key coding keeps the order of the regex strings,
+	and the sort is stable, so the sorted entries are the matches matrix
+	column by column, each column holding its words in order.
+	The work is linear in numwords*(2^wl-1)
 */
-void gensets(set<int> R, set<int> P, set<int> X, vector<set<int> > &combos) {
-
-	if( P.empty() )	return;
-
-	int x;
-	set<int> P2, X2;
-	set<int>::iterator itr;
-	for(itr=P.begin(); itr!=P.end(); ++itr) {
-		x = *itr;
-		if( X.find(x) == X.end() ) {
-			R.insert(x);
-			combos.push_back(R);
-			P2 = P;
-			P2.erase(x);
-			X.insert(x);
-			gensets(R, P2, X, combos);
-			R.erase(x);
-		}
+void build_matches(vector<string>& dict, int wl, int numthreads, vector<string>& regs, vector<int>& csc1, vector<int>& csc2) {
+
+	int nw = dict.size();
+	int nc = (1 << wl) - 1;
+	long nnz = (long)nw*nc;
+	if( nw >= (1 << WORDBITS) ) {
+		cout << "ERROR: more than " << (1 << WORDBITS) << " words" << endl;
+		exit(-1);
 	}
-	return;
-}
 
-/*
-	populate the character array called regexes with all possible regex combinations from the wordlist.
-	e.g. for a word like "route", generate "r****", "ro***", "**u**", "ro*te," etc.  
-	do this for every word, and store the result in the long regexes array
-	use the combos array that holds all possible combinations of indices of words of length wordlen.
-	duplicates are possible
-	
-	nw = number of words
-	nc = number of combos
-	wl = length of words
-*/
-void populate_regexes(vector<string>& dict, vector<set<int> > &combos, char* regexes, int nw, int nc, int wl) {
-
-	int pos, elem;
-	string word;
-	set<int> S;
-	set<int>::iterator itr;
-	for(int i=0; i<nw; i++) {
-		word = dict[i];
-		for(int j=0; j<nc; j++) {
-			S=combos[j];
-			itr=S.begin();
-			pos=0;
-			while( itr != S.end() ) {
-				elem = *itr;
-				if( elem == pos ) {				
-					regexes[(i*nc*wl)+(j*wl)+pos] = word[elem];					
-					pos++;
-					itr++;
-				} else {
-					pos++;
-				} 
+	/* fill the key entries, each thread a range of words */
+	vector<uint64> entries(nnz), scratch(nnz);
+	vector<thread> threads;
+	for(int t=0; t<numthreads; t++) {
+		int lo = (long)nw*t/numthreads;
+		int hi = (long)nw*(t+1)/numthreads;
+		threads.push_back( thread(gen_keys, ref(dict), wl, lo, hi, ref(entries)) );
+	}
+	for(int t=0; t<numthreads; t++) threads[t].join();
+
+	radix_sort( entries, scratch, KEYBITS*wl, WORDBITS, numthreads );
+
+	/* each run of equal keys is one regex, one column of the matrix */
+	regs.clear();
+	csc1.assign(1, 0);
+	csc2.resize(nnz);
+	uint64 mask = ((uint64)1 << (KEYBITS*wl)) - 1;
+	uint64 prev = 0;
+	for(long i=0; i<nnz; i++) {
+		uint64 key = (entries[i] >> WORDBITS) & mask;
+		if( i == 0 || key != prev ) {
+			if( i > 0 ) csc1.push_back(i);
+			string reg(wl, '*');
+			for(int k=wl-1; k>=0; k--) {
+				reg[k] = code_char( (key >> (KEYBITS*(wl-1-k))) & ((1 << KEYBITS)-1) );
 			}
+			regs.push_back(reg);
+			prev = key;
 		}
+		csc2[i] = (int)(entries[i] & ((1 << WORDBITS)-1));
 	}
+	csc1.push_back(nnz);
 
 	return;
 }
 
 /*
-	Using the regex array created in populate_regexes()
-	remove all duplicates by adding each regex to a set
+	Pack every regex of the words in [lo, hi) into key entries,
+	the key above the word index in the low WORDBITS bits.
+	Entry word*nc+j holds the regex of word for position subset j+1
 */
-void populate_regset(set<string>& rhash, char* regexes, int nw, int nc, int wl) {
+void gen_keys(vector<string>& dict, int wl, int lo, int hi, vector<uint64>& entries) {
 
-	string word(wl, '*');
-	for(int i=0; i<nw; i++) {
-		for(int j=0; j<nc; j++) {
+	int nc = (1 << wl) - 1;
+	for(int i=lo; i<hi; i++) {
+		const string& word = dict[i];
+		for(int j=1; j<=nc; j++) {
+			uint64 key = 0;
 			for(int k=0; k<wl; k++) {
-				word[k] = regexes[(i*nc*wl) + (j*wl) + k];
-			}
-			if( rhash.find(word) == rhash.end() ) {
-				rhash.insert(word);
+				key <<= KEYBITS;
+				if( j & (1 << (wl-1-k)) ) key |= key_code(word[k]);
 			}
+			entries[(long)i*nc + j-1] = (key << WORDBITS) | (uint64)i;
 		}
 	}
 
@@ -380,90 +384,58 @@ void populate_regset(set<string>& rhash, char* regexes, int nw, int nc, int wl)
 }
 
 /*
-	Using the set created by populate_regset(), 
-	convert it to a vector for easier access
+	Stable least significant digit radix sort of the entries
+	on the keybits bits starting at bit shift, in passes of at most 12 bits.
+	Each pass splits the entries into one range per thread:
+	every thread counts the digits in its range,
+	the counts are summed into starting offsets in (digit, thread) order,
+	then every thread scatters its range, which keeps the sort stable
 */
-vector<string> set2vec(set<string>& regset) {
-	vector<string> regvec;
-	set<string>::iterator itr;
-	for(itr = regset.begin(); itr != regset.end(); ++itr) {
-		regvec.push_back( *itr );
-	}
-	regset.clear();
-	return regvec;
-}
-
-/*
-	Populate the matches matrix
-	Iterate through every word in the dictionary wordlist
-	Then for each word, iterate through every possible regex.
-	If the given word fits the given regex (e.g. "route" fits "r**t*"),
-	then set the corresponding bit in matches to 1
-*/
-//void populate_matches(Bits* matches, vector<string>& dict, vector<string>& regs, int wordlen ) {
-void populate_matches(vector<int>& csc1, vector<int>& csc2, vector<string>& dict, vector<string>& regs, int wordlen ) {
-
-	int numwords = dict.size();
-	int numregs = regs.size();
-
-	string word, reg;
-	//long index, rem;
-	
-	/*
-	for(long i=0; i<numwords; i++) {
-		if(i%1000==0) cout << "matching " << i << "th word" << endl;
-		word=dict[i];
-		for(long j=0; j<numregs; j++) {
-			reg=regs[j];
-			if( match(word, reg, wordlen) ) {
-				index = i*numregs + j;
-				rem = index%8;
-				index /= 8;
-
-				switch(rem) {
-					case 0: matches[index].bit0=1; break;
-					case 1: matches[index].bit1=1; break;
-					case 2: matches[index].bit2=1; break;
-					case 3: matches[index].bit3=1; break;
-					case 4: matches[index].bit4=1; break;
-					case 5: matches[index].bit5=1; break;
-					case 6: matches[index].bit6=1; break;
-					case 7: matches[index].bit7=1; break;
-				}
-			}
+void radix_sort(vector<uint64>& entries, vector<uint64>& scratch, int keybits, int shift, int numthreads) {
+
+	long n = entries.size();
+	int passes = (keybits + 11) / 12;
+	for(int p=0; p<passes; p++) {
+		int lo_bit = keybits*p/passes;
+		int bits = keybits*(p+1)/passes - lo_bit;
+		int radix = 1 << bits;
+		int dshift = shift + lo_bit;
+		uint64 dmask = radix - 1;
+
+		vector<vector<long> > counts(numthreads, vector<long>(radix, 0));
+		vector<thread> threads;
+		for(int t=0; t<numthreads; t++) {
+			threads.push_back( thread([&, t]() {
+				long lo = n*t/numthreads, hi = n*(t+1)/numthreads;
+				vector<long>& c = counts[t];
+				for(long i=lo; i<hi; i++) c[ (entries[i] >> dshift) & dmask ]++;
+			}) );
 		}
-	}*/
-	csc1[0]=0;
-	int count=0;
-	for(int i=0; i<numregs; i++) {
-		if(i%10000==0) cout << "matching " << i << "th regex" << endl;
-		reg=regs[i];
-		for(int j=0; j<numwords; j++) {
-			word=dict[j];
-			if( match(word, reg, wordlen) ) {
-				csc2[count]=j;
-				count++;
+		for(int t=0; t<numthreads; t++) threads[t].join();
+		threads.clear();
+
+		long sum = 0;
+		for(int d=0; d<radix; d++) {
+			for(int t=0; t<numthreads; t++) {
+				long c = counts[t][d];
+				counts[t][d] = sum;
+				sum += c;
 			}
 		}
-		csc1[i+1]=count;
-	}
-
-	return;
-}
 
-/* 
-	Test if a given word matches the given regex
-	return true if so, else false
- */
-bool match(string word, string regex, int wordlen) {
-
-	for(int i=0; i<wordlen; i++) {
-		if( regex[i] != '*' && word[i] != regex[i] ) {
-			return false;
+		for(int t=0; t<numthreads; t++) {
+			threads.push_back( thread([&, t]() {
+				long lo = n*t/numthreads, hi = n*(t+1)/numthreads;
+				vector<long>& c = counts[t];
+				for(long i=lo; i<hi; i++) scratch[ c[ (entries[i] >> dshift) & dmask ]++ ] = entries[i];
+			}) );
 		}
+		for(int t=0; t<numthreads; t++) threads[t].join();
+
+		entries.swap(scratch);
 	}
 
-	return true;
+	return;
 }
 
 /* write the compressed spares column data to a file */
@@ -474,19 +446,75 @@ void write_matches_csc(vector<int>& csc1, vector<int>& csc2, string outfile) {
 	ofstream outstream;
 	outstream.open( outfile );
 	
-	outstream << c1_size << endl;
+	outstream << c1_size << '\n';
 	for(int i=0; i<c1_size; i++) {
-		outstream << csc1[i] << endl;
+		outstream << csc1[i] << '\n';
 	}
 	
-	outstream << c2_size << endl;
+	outstream << c2_size << '\n';
 	for(int i=0; i<c2_size; i++) {
-		outstream << csc2[i] << endl;
+		outstream << csc2[i] << '\n';
 	}
 	
 	outstream.close();
 }
 
+/*
+	write the wordlist, regex list, csc matrix, and the word weights
+	if there are any to a single binary index.
+	The whole file is assembled in memory so the checksum
+	can be computed before the header is written
+*/
+void write_index(vector<string>& dict, vector<string>& regs, vector<int>& csc1, vector<int>& csc2, vector<int>& weights, int wordlen, string outfile) {
+
+	IndexHeader header;
+	memset(&header, 0, sizeof(header));
+	strcpy(header.magic, WSINDEX_MAGIC);
+	header.version = WSINDEX_VERSION;
+	header.wordlen = wordlen;
+	header.numwords = dict.size();
+	header.numregs = regs.size();
+	header.nnz = csc2.size();
+
+	header.words_off = index_align( sizeof(IndexHeader) );
+	header.regs_off = index_align( header.words_off + (uint64_t)header.numwords*wordlen );
+	header.csc1_off = index_align( header.regs_off + (uint64_t)header.numregs*wordlen );
+	header.csc2_off = index_align( header.csc1_off + csc1.size()*sizeof(int32_t) );
+	header.filesize = header.csc2_off + csc2.size()*sizeof(int32_t);
+	if( !weights.empty() ) {
+		header.weights_off = index_align( header.filesize );
+		header.filesize = header.weights_off + weights.size()*sizeof(int32_t);
+	}
+
+	vector<char> buf(header.filesize, 0);
+	for(unsigned i=0; i<dict.size(); i++) {
+		memcpy(&buf[header.words_off + (uint64_t)i*wordlen], dict[i].data(), wordlen);
+	}
+	for(unsigned i=0; i<regs.size(); i++) {
+		memcpy(&buf[header.regs_off + (uint64_t)i*wordlen], regs[i].data(), wordlen);
+	}
+	for(unsigned i=0; i<csc1.size(); i++) {
+		int32_t val = csc1[i];
+		memcpy(&buf[header.csc1_off + i*sizeof(int32_t)], &val, sizeof(int32_t));
+	}
+	for(unsigned i=0; i<csc2.size(); i++) {
+		int32_t val = csc2[i];
+		memcpy(&buf[header.csc2_off + i*sizeof(int32_t)], &val, sizeof(int32_t));
+	}
+	for(unsigned i=0; i<weights.size(); i++) {
+		int32_t val = weights[i];
+		memcpy(&buf[header.weights_off + i*sizeof(int32_t)], &val, sizeof(int32_t));
+	}
+
+	header.checksum = index_checksum(&buf[sizeof(IndexHeader)], header.filesize - sizeof(IndexHeader));
+	memcpy(&buf[0], &header, sizeof(IndexHeader));
+
+	ofstream outstream;
+	outstream.open( outfile.c_str(), ios::binary );
+	outstream.write( &buf[0], buf.size() );
+	outstream.close();
+}
+
 /*
 	get current time, for timing
 */
@@ -502,8 +530,3 @@ uint64 getTimeMs64()
   ret += (tv.tv_sec*1000);
   return ret;
 }
-
-void write_output(vector<int>& csc1, vector<int>& csc2, string filename) {
-
-
-}
@@ -0,0 +1,250 @@
+/*
+	Server protocol check for wordsquares, servecheck.cpp
+	Copyright 2024, Ryan McCune	<robertryanmccune@gmail.com>
+
+	Starts the wordsquare program with --serve on a scratch socket,
+	sends it requests, and checks every reply line is valid JSON.
+	Bad requests carrying quotes, backslashes, and control characters
+	must come back as error lines that decode to the text sent,
+	and a good query must still stream its squares and a done line.
+	A client that sends a large query and never reads its squares
+	must not keep the next client waiting past the send timeout.
+	Exits non-zero at the first failed check, see make servecheck
+
+	This software is distributed under
+	the modified Berkeley Software Distribution (BSD) License.
+*/
+#include <iostream>
+#include <string>
+#include <map>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstdio>
+#include <csignal>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+static pid_t server = -1;
+static string sockpath;
+
+// stop the server and remove its socket
+static void cleanup() {
+	if( server > 0 ) {
+		kill(server, SIGTERM);
+		waitpid(server, NULL, 0);
+		server = -1;
+	}
+	unlink(sockpath.c_str());
+}
+
+static void fail(string msg) {
+	cout << "FAIL: " << msg << endl;
+	cleanup();
+	exit(1);
+}
+
+/*
+	Parse one line of JSON holding a flat object of strings, numbers,
+	and booleans, the only values the server sends.  Strings are
+	decoded, numbers and booleans kept as written.
+	Return false if the line isn't valid JSON of that shape
+*/
+static bool parse_string(const string& s, size_t& i, string& out) {
+	if( i >= s.size() || s[i] != '"' ) return false;
+	i++;
+	out.clear();
+	while( i < s.size() ) {
+		unsigned char c = s[i++];
+		if( c == '"' ) return true;
+		if( c < 0x20 ) return false;
+		if( c != '\\' ) {
+			out += c;
+			continue;
+		}
+		if( i >= s.size() ) return false;
+		char e = s[i++];
+		if( e == '"' || e == '\\' || e == '/' ) out += e;
+		else if( e == 'n' ) out += '\n';
+		else if( e == 't' ) out += '\t';
+		else if( e == 'r' ) out += '\r';
+		else if( e == 'b' ) out += '\b';
+		else if( e == 'f' ) out += '\f';
+		else if( e == 'u' ) {
+			if( i+4 > s.size() ) return false;
+			unsigned code = 0;
+			for(int k=0; k<4; k++) {
+				char h = s[i++];
+				code <<= 4;
+				if( h >= '0' && h <= '9' ) code |= h-'0';
+				else if( h >= 'a' && h <= 'f' ) code |= h-'a'+10;
+				else if( h >= 'A' && h <= 'F' ) code |= h-'A'+10;
+				else return false;
+			}
+			if( code > 0x7f ) return false;		// the server only escapes ASCII here
+			out += (char)code;
+		} else {
+			return false;
+		}
+	}
+	return false;
+}
+
+static bool parse_object(const string& s, map<string,string>& fields) {
+	fields.clear();
+	size_t i = 0;
+	if( s.empty() || s[i++] != '{' ) return false;
+	while( i < s.size() ) {
+		string key, value;
+		if( !parse_string(s, i, key) ) return false;
+		if( i >= s.size() || s[i++] != ':' ) return false;
+		if( i < s.size() && s[i] == '"' ) {
+			if( !parse_string(s, i, value) ) return false;
+		} else if( i < s.size() && s[i] == '[' ) {
+			// a square's rows, an array of strings
+			i++;
+			while( i < s.size() && s[i] != ']' ) {
+				string row;
+				if( !parse_string(s, i, row) ) return false;
+				value += row;
+				if( i < s.size() && s[i] == ',' ) i++;
+			}
+			if( i >= s.size() ) return false;
+			i++;
+		} else {
+			size_t end = s.find_first_of(",}", i);
+			if( end == string::npos || end == i ) return false;
+			value = s.substr(i, end-i);
+			if( value != "true" && value != "false" && value.find_first_not_of("-0123456789") != string::npos ) return false;
+			i = end;
+		}
+		fields[key] = value;
+		if( i >= s.size() ) return false;
+		if( s[i] == '}' ) return i+1 == s.size();
+		if( s[i++] != ',' ) return false;
+	}
+	return false;
+}
+
+// connect to the server, waiting for it to create its socket
+static int connect_server() {
+	struct sockaddr_un addr;
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sockpath.c_str());
+	for(int tries=0; tries<200; tries++) {
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if( fd < 0 ) fail("cannot create a socket");
+		if( connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 ) return fd;
+		close(fd);
+		this_thread::sleep_for(chrono::milliseconds(50));
+	}
+	fail("server never opened " + sockpath);
+	return -1;
+}
+
+static void send_line(int fd, const string& line) {
+	string msg = line + "\n";
+	if( write(fd, msg.data(), msg.size()) != (ssize_t)msg.size() ) fail("cannot send " + line);
+}
+
+// read one reply line, failing if none comes within wait ms
+static string read_reply(int fd, string& inbuf, int wait) {
+	while( inbuf.find('\n') == string::npos ) {
+		struct pollfd p;
+		p.fd = fd;
+		p.events = POLLIN;
+		if( poll(&p, 1, wait) <= 0 ) fail("no reply from the server");
+		char buf[4096];
+		ssize_t n = read(fd, buf, sizeof(buf));
+		if( n <= 0 ) fail("server closed the connection");
+		inbuf.append(buf, n);
+	}
+	size_t nl = inbuf.find('\n');
+	string line = inbuf.substr(0, nl);
+	inbuf.erase(0, nl+1);
+	return line;
+}
+
+// send a bad request, its error reply must decode to a message holding the text sent
+static void check_error(int fd, string& inbuf, const string& request, const string& echoed) {
+	send_line(fd, request);
+	string reply = read_reply(fd, inbuf, 10000);
+	map<string,string> fields;
+	if( !parse_object(reply, fields) ) fail("reply is not valid JSON: " + reply);
+	if( fields.count("error") == 0 ) fail("no error in reply: " + reply);
+	if( fields["error"].find(echoed) == string::npos ) fail("error doesn't echo the request: " + reply);
+	cout << "ok: " << reply << endl;
+}
+
+// send a good query, it must stream squares then end complete within wait ms
+static void check_query(int fd, string& inbuf, int wait) {
+	send_line(fd, "solve utah- meme- -todo amtoo teeth");
+	long squares = 0;
+	while( true ) {
+		string reply = read_reply(fd, inbuf, wait);
+		map<string,string> fields;
+		if( !parse_object(reply, fields) ) fail("reply is not valid JSON: " + reply);
+		if( fields.count("done") == 0 ) {
+			squares++;
+			continue;
+		}
+		if( fields["status"] != "complete" || fields["count"] != to_string(squares) ) {
+			fail("query ended badly: " + reply);
+		}
+		cout << "ok: " << reply << endl;
+		break;
+	}
+	if( squares == 0 ) fail("query found no squares");
+}
+
+int main(int argc, char **argv) {
+
+	if( argc != 3 ) {
+		cout << "usage: servecheck wordsquares index" << endl;
+		return 1;
+	}
+	sockpath = "/tmp/wsservecheck." + to_string(getpid()) + ".sock";
+
+	server = fork();
+	if( server < 0 ) fail("cannot fork");
+	if( server == 0 ) {
+		if( freopen("/dev/null", "w", stdout) == NULL ) {}
+		execl(argv[1], argv[1], "--pool", "1", "--serve", sockpath.c_str(), argv[2], (char*)NULL);
+		_exit(127);
+	}
+
+	int fd = connect_server();
+	string inbuf;
+
+	check_error(fd, inbuf, "solve ab\"c utah- meme- -todo", "ab\"c");
+	check_error(fd, inbuf, "solve ab\\c utah- meme- -todo", "ab\\c");
+	check_error(fd, inbuf, "solve a\x01\x1b" "b utah- meme- -todo", "a\x01\x1b" "b");
+	check_error(fd, inbuf, "bogus\"},{\"x\\y", "bogus\"},{\"x\\y");
+	check_error(fd, inbuf, "bogus\x7f" "x", "bogus\x7f" "x");
+
+	// the connection must still answer a good query
+	check_query(fd, inbuf, 10000);
+	send_line(fd, "quit");
+	close(fd);
+
+	/*
+		the server has one pool thread, so a client that stops reading
+		holds it until its sends time out, 10 seconds each
+	*/
+	int stalled = connect_server();
+	send_line(stalled, "solve utah- m---- -e---");
+	fd = connect_server();
+	inbuf.clear();
+	check_query(fd, inbuf, 60000);
+	send_line(fd, "quit");
+	close(fd);
+	close(stalled);
+	cleanup();
+	cout << "server replies are valid JSON, a stalled client was dropped" << endl;
+	return 0;
+}